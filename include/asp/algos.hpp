@@ -1,8 +1,16 @@
 #pragma once
 
 #include <asp/segmentation.hpp>
+#include <asp/alic.hpp>
+#include <asp/execution.hpp>
+#include <asp/hierarchy.hpp>
+#include <asp/roi.hpp>
+#include <asp/sequence.hpp>
+#include <asp/view.hpp>
 #include <slimage/image.hpp>
 #include <Eigen/Dense>
+#include <functional>
+#include <vector>
 
 namespace asp
 {
@@ -24,6 +32,11 @@ namespace asp
 			color += v.color;
 		}
 
+		void deaccumulate(const PixelRgb& v)
+		{
+			color -= v.color;
+		}
+
 		void normalize(float weight)
 		{
 			color /= weight;
@@ -31,42 +44,177 @@ namespace asp
 
 	};
 
-	/** RGB-D pixel data (including 3D position and 3D normal) */
-	struct PixelRgbd
+	/** Distance function for RGB superpixels (SLIC and ASP)
+	 * Mixes the squared image distance relative to the superpixel radius and the squared color distance.
+	 */
+	struct PixelRgbDistance
 	{
-		Eigen::Vector3f color;
-		float depth;
-		Eigen::Vector3f world;
-		Eigen::Vector3f normal;
+		float compactness;
 
-		static PixelRgbd Zero()
-		{ return {
-			Eigen::Vector3f::Zero(),
-			0.0f,
-			Eigen::Vector3f::Zero(),
-			Eigen::Vector3f::Zero()
-		}; }
+		float operator()(const Superpixel<PixelRgb>& a, const Pixel<PixelRgb>& b) const
+		{
+			return compactness * (a.position - b.position).squaredNorm() / (a.radius * a.radius)
+				+ (1.0f - compactness) * (a.data.color - b.data.color).squaredNorm();
+		}
+	};
 
-		using accumulate_t = PixelRgbd;
+	/** Features of RGB-D pixels which can be enabled at compile time */
+	enum RgbdFeature : unsigned
+	{
+		RgbdColor = 1,
+		RgbdDepth = 2,
+		RgbdWorld = 4,
+		RgbdNormal = 8,
+		RgbdAll = RgbdColor | RgbdDepth | RgbdWorld | RgbdNormal
+	};
+
+	namespace detail
+	{
+		/** Parts of RGB-D pixel data, disabled parts are empty and all operations are no-ops */
+		template<bool Enabled>
+		struct RgbdColorPart
+		{
+			void zero() {}
+			void accumulate(const RgbdColorPart&) {}
+			void deaccumulate(const RgbdColorPart&) {}
+			void normalize(float) {}
+		};
 
-		void accumulate(const PixelRgbd& v)
+		template<>
+		struct RgbdColorPart<true>
 		{
-			color += v.color;
-			depth += v.depth;
-			world += v.world;
-			normal += v.normal; // FIXME compute normal mean correctly
+			Eigen::Vector3f color;
+			void zero() { color = Eigen::Vector3f::Zero(); }
+			void accumulate(const RgbdColorPart& v) { color += v.color; }
+			void deaccumulate(const RgbdColorPart& v) { color -= v.color; }
+			void normalize(float weight) { color /= weight; }
+		};
+
+		template<bool Enabled>
+		struct RgbdDepthPart
+		{
+			void zero() {}
+			void accumulate(const RgbdDepthPart&) {}
+			void deaccumulate(const RgbdDepthPart&) {}
+			void normalize(float) {}
+		};
+
+		template<>
+		struct RgbdDepthPart<true>
+		{
+			float depth;
+			void zero() { depth = 0.0f; }
+			void accumulate(const RgbdDepthPart& v) { depth += v.depth; }
+			void deaccumulate(const RgbdDepthPart& v) { depth -= v.depth; }
+			void normalize(float weight) { depth /= weight; }
+		};
+
+		template<bool Enabled>
+		struct RgbdWorldPart
+		{
+			void zero() {}
+			void accumulate(const RgbdWorldPart&) {}
+			void deaccumulate(const RgbdWorldPart&) {}
+			void normalize(float) {}
+		};
+
+		template<>
+		struct RgbdWorldPart<true>
+		{
+			Eigen::Vector3f world;
+			void zero() { world = Eigen::Vector3f::Zero(); }
+			void accumulate(const RgbdWorldPart& v) { world += v.world; }
+			void deaccumulate(const RgbdWorldPart& v) { world -= v.world; }
+			void normalize(float weight) { world /= weight; }
+		};
+
+		template<bool Enabled>
+		struct RgbdNormalPart
+		{
+			void zero() {}
+			void accumulate(const RgbdNormalPart&) {}
+			void deaccumulate(const RgbdNormalPart&) {}
+			void normalize(float) {}
+		};
+
+		template<>
+		struct RgbdNormalPart<true>
+		{
+			Eigen::Vector3f normal;
+			void zero() { normal = Eigen::Vector3f::Zero(); }
+			void accumulate(const RgbdNormalPart& v) { normal += v.normal; }
+			void deaccumulate(const RgbdNormalPart& v) { normal -= v.normal; }
+			void normalize(float)
+			{
+				// mean direction of unit normals is the normalized sum,
+				// normals which cancel out fall back to the camera facing normal as used for invalid pixels
+				const float len = normal.norm();
+				normal = (len > 0.0f) ? Eigen::Vector3f(normal / len) : Eigen::Vector3f(0.0f, 0.0f, -1.0f);
+			}
+		};
+	}
+
+	/** RGB-D pixel data composed of the features F (see RgbdFeature)
+	 * Disabled features cost no memory and are not accumulated.
+	 */
+	template<unsigned F>
+	struct PixelRgbdF
+	:	detail::RgbdColorPart<(F & RgbdColor) != 0>,
+		detail::RgbdDepthPart<(F & RgbdDepth) != 0>,
+		detail::RgbdWorldPart<(F & RgbdWorld) != 0>,
+		detail::RgbdNormalPart<(F & RgbdNormal) != 0>
+	{
+		using color_part = detail::RgbdColorPart<(F & RgbdColor) != 0>;
+		using depth_part = detail::RgbdDepthPart<(F & RgbdDepth) != 0>;
+		using world_part = detail::RgbdWorldPart<(F & RgbdWorld) != 0>;
+		using normal_part = detail::RgbdNormalPart<(F & RgbdNormal) != 0>;
+
+		static constexpr bool has_color = (F & RgbdColor) != 0;
+		static constexpr bool has_depth = (F & RgbdDepth) != 0;
+		static constexpr bool has_world = (F & RgbdWorld) != 0;
+		static constexpr bool has_normal = (F & RgbdNormal) != 0;
+
+		static PixelRgbdF Zero()
+		{
+			PixelRgbdF p;
+			p.color_part::zero();
+			p.depth_part::zero();
+			p.world_part::zero();
+			p.normal_part::zero();
+			return p;
+		}
+
+		using accumulate_t = PixelRgbdF;
+
+		void accumulate(const PixelRgbdF& v)
+		{
+			color_part::accumulate(v);
+			depth_part::accumulate(v);
+			world_part::accumulate(v);
+			normal_part::accumulate(v);
+		}
+
+		void deaccumulate(const PixelRgbdF& v)
+		{
+			color_part::deaccumulate(v);
+			depth_part::deaccumulate(v);
+			world_part::deaccumulate(v);
+			normal_part::deaccumulate(v);
 		}
 
 		void normalize(float weight)
 		{
-			color /= weight;
-			depth /= weight;
-			world /= weight;
-			normal.normalize(); // FIXME compute normal mean correctly
+			color_part::normalize(weight);
+			depth_part::normalize(weight);
+			world_part::normalize(weight);
+			normal_part::normalize(weight);
 		}
 
 	};
 
+	/** RGB-D pixel data (including 3D position and 3D normal) */
+	using PixelRgbd = PixelRgbdF<RgbdAll>;
+
 	/** Parameters for the SLIC algorithm */
 	struct SlicParameters
 	{
@@ -75,20 +223,77 @@ namespace asp
 
 		// tradeoff between compact superpixels (compactness=1) and boundary recall (compactness=0)
 		float compactness = 0.15f;
+
+		// parameters for the clustering step
+		AlicParameters alic;
 	};
 
 	/** Simple Iterative Clustering superpixel algorithm for color images */
-	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& color, const SlicParameters& opt=SlicParameters());
+	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& color, const SlicParameters& opt=SlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** SLIC superpixels which read the color pixels through a view (without copying them into an image) */
+	Segmentation<PixelRgb> SuperpixelsSlic(const ColorView& color, const SlicParameters& opt=SlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** SLIC superpixels only for pixels where the mask is non-zero
+	 * Each connected part of the mask (see MaskRegions) is converted, seeded and clustered separately
+	 * within its bounding box. Superpixels have the same size as for the full image. Labels and weights
+	 * are in image coordinates, labels are -1 outside of the mask. The input image of the result is empty.
+	 */
+	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& color, const slimage::Image1ub& mask, const SlicParameters& opt=SlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** SLIC superpixels only for pixels inside the regions of interest
+	 * Each region is processed separately, overlapping regions are processed together (see MergeRois).
+	 */
+	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& color, const std::vector<Roi>& rois, const SlicParameters& opt=SlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** SLIC superpixels for several superpixel counts (opt.num_superpixels is ignored) */
+	SegmentationHierarchy<PixelRgb> SuperpixelsSlicHierarchy(const slimage::Image3ub& color, const std::vector<unsigned>& counts, const SlicParameters& opt=SlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
 
 	/** Parameters for the ASP algorithm */
 	struct AspParameters
 	{
 		// tradeoff between compact superpixels (compactness=1) and boundary recall (compactness=0)
 		float compactness = 0.15f;
+
+		// parameters for the clustering step
+		AlicParameters alic;
 	};
 
 	/** Adaptive Superpixels algorithm for color images with a user defined density function */
-	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const AspParameters& opt=AspParameters());
+	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const AspParameters& opt=AspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** ASP superpixels which read color and density through views (without copying them into images)
+	 * Throws std::runtime_error if the views do not have the same size.
+	 */
+	Segmentation<PixelRgb> SuperpixelsAsp(const ColorView& color, const DensityView& density, const AspParameters& opt=AspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** ASP superpixels only for pixels where the mask is non-zero (see SuperpixelsSlic with mask) */
+	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const slimage::Image1ub& mask, const AspParameters& opt=AspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** ASP superpixels only for pixels inside the regions of interest (see SuperpixelsSlic with regions of interest) */
+	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const std::vector<Roi>& rois, const AspParameters& opt=AspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Computes a mask of pixels which changed since the previous frame
+	 * A pixel changed if its color (in [0,1]) differs by more than color_threshold
+	 * or if its density differs by more than density_threshold relative to the larger density.
+	 */
+	slimage::Image1ub AspChangeMask(const Segmentation<PixelRgb>& previous, const slimage::Image3ub& color, const slimage::Image1f& density,
+		float color_threshold=0.1f, float density_threshold=0.1f, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Updates ASP superpixels of the previous frame where the new frame changed
+	 * Only superpixels close to pixels marked in 'changed' are recomputed, all other superpixels are kept.
+	 * The previous segmentation is copied, see the overload below for updating it in place.
+	 * See ALICUpdate for the used ALIC parameters.
+	 */
+	Segmentation<PixelRgb> SuperpixelsAspUpdate(const Segmentation<PixelRgb>& previous, const slimage::Image3ub& color, const slimage::Image1f& density,
+		const slimage::Image1ub& changed, const AspParameters& opt=AspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Updates ASP superpixels in place, reusing the images of the previous segmentation
+	 * The images of 'previous' must not be shared with other segmentations (slimage images share their pixels when copied).
+	 * Cost is proportional to the changed region.
+	 */
+	Segmentation<PixelRgb> SuperpixelsAspUpdate(Segmentation<PixelRgb>&& previous, const slimage::Image3ub& color, const slimage::Image1f& density,
+		const slimage::Image1ub& changed, const AspParameters& opt=AspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
 
 	/** Parameters for the DASP algorithm */
 	struct DaspParameters
@@ -96,6 +301,13 @@ namespace asp
 		// focal length in pixel of the camera (used to compute correct 3D points)
 		float focal_px = 540.0f;
 
+		// focal length in pixel in y direction (if 0 focal_px is used)
+		float focal_px_y = 0.0f;
+
+		// principal point of the camera in pixel (if negative the image center is used)
+		float center_x = -1.0f;
+		float center_y = -1.0f;
+
 		// factor for converting Primesense depth values to meters 
 		float depth_to_z = 0.001f;
 
@@ -110,8 +322,139 @@ namespace asp
 
 		// tradeoff between using color (normal_weight=0) and normals (normal_weight=1) as data term in the distance function
 		float normal_weight = 0.2f;
+
+		// if enabled SuperpixelsDasp computes all pixel features, otherwise only the ones needed by the
+		// distance function (see DaspRequiredFeatures) and superpixels have default values for the others
+		bool full_feature_means = false;
+
+		// parameters for the clustering step
+		AlicParameters alic;
 	};
 
-	/** Depth-Adaptive Superpixels for RGB-D images */
-	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const DaspParameters& opt=DaspParameters());
+	/** Precomputed camera backprojection tables for DASP
+	 * The 3D point of pixel (x,y) with raw depth value d is d * (ray_x[x], ray_y[y], ray_z).
+	 * Tables only depend on image size and camera parameters and can be reused for all frames of a stream.
+	 */
+	struct DaspCamera
+	{
+		unsigned width = 0;
+		unsigned height = 0;
+
+		// camera parameters used to compute the tables
+		float fx = 0.0f, fy = 0.0f, cx = 0.0f, cy = 0.0f;
+		float depth_to_z = 0.0f;
+		float radius = 0.0f;
+
+		// per column and per row ray components (including the depth_to_z factor)
+		std::vector<float> ray_x;
+		std::vector<float> ray_y;
+		float ray_z = 0.0f;
+
+		// factor to compute pixel density from the squared raw depth value
+		float density_scale = 0.0f;
+
+		DaspCamera() = default;
+
+		DaspCamera(unsigned width, unsigned height, const DaspParameters& opt);
+
+		/** True if the tables were computed for this image size and camera */
+		bool matches(unsigned width, unsigned height, const DaspParameters& opt) const;
+	};
+
+	/** Depth-Adaptive Superpixels for RGB-D images
+	 * Pixels only get the features needed for the parameters (see DaspRequiredFeatures) and are
+	 * converted to PixelRgbd after clustering. Labels are the same as with SuperpixelsDaspF<RgbdAll>.
+	 * Features which were not computed are black color and camera facing normals (depth is the z
+	 * coordinate of the 3D point), unless opt.full_feature_means is set.
+	 */
+	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** DASP superpixels which read color and depth through a frame view (without copying them into images) */
+	Segmentation<PixelRgbd> SuperpixelsDasp(const RawFrameView& frame, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** DASP superpixels only for pixels where the mask is non-zero (see SuperpixelsSlic with mask)
+	 * Depth gradients near the mask border still use depth values outside of the mask.
+	 * If opt.num_superpixels is greater 0 it is the number of superpixels inside the mask.
+	 */
+	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const slimage::Image1ub& mask, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** DASP superpixels only for pixels inside the regions of interest (see SuperpixelsSlic with regions of interest) */
+	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const std::vector<Roi>& rois, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Pixel features which the DASP distance function uses with the given parameters (always includes RgbdWorld) */
+	unsigned DaspRequiredFeatures(const DaspParameters& opt);
+
+	/** Depth-Adaptive Superpixels with a pixel type which only has the features F
+	 * Pixel features which are not in F are neither computed nor stored.
+	 * Available for RgbdAll and for all feature sets returned by DaspRequiredFeatures.
+	 */
+	template<unsigned F>
+	Segmentation<PixelRgbdF<F>> SuperpixelsDaspF(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Computes DASP superpixels with the smallest pixel type for the given parameters and calls f(segmentation)
+	 * f must accept Segmentation<PixelRgbdF<F>> for all feature sets F returned by DaspRequiredFeatures.
+	 */
+	template<typename Fn>
+	void SuperpixelsDaspDispatch(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const DaspParameters& opt, Fn f, const ExecutionContext& exec=ExecutionContext::Serial())
+	{
+		switch(DaspRequiredFeatures(opt)) {
+		case RgbdWorld:
+			f(SuperpixelsDaspF<RgbdWorld>(color, depth, opt, exec));
+			break;
+		case RgbdWorld | RgbdColor:
+			f(SuperpixelsDaspF<RgbdWorld | RgbdColor>(color, depth, opt, exec));
+			break;
+		case RgbdWorld | RgbdNormal:
+			f(SuperpixelsDaspF<RgbdWorld | RgbdNormal>(color, depth, opt, exec));
+			break;
+		default:
+			f(SuperpixelsDaspF<RgbdWorld | RgbdColor | RgbdNormal>(color, depth, opt, exec));
+			break;
+		}
+	}
+
+	/** DASP superpixels for several superpixel counts with pixel features computed only once (opt.num_superpixels is ignored) */
+	SegmentationHierarchy<PixelRgbd> SuperpixelsDaspHierarchy(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const std::vector<unsigned>& counts, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** DASP stage 1: computes pixel features (3D points, normals and density) */
+	slimage::Image<Pixel<PixelRgbd>,1> DaspPixels(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** DASP stage 1 with backprojection tables which are reused across frames
+	 * If density_scale is not null it receives the factor which was applied to the densities for opt.num_superpixels
+	 * (store it in Segmentation::density_scale of the clustering result for incremental updates).
+	 */
+	slimage::Image<Pixel<PixelRgbd>,1> DaspPixels(const slimage::Image3ub& color, const slimage::Image1ui16& depth, const DaspCamera& camera, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial(),
+		float* density_scale=nullptr);
+
+	/** DASP stage 1 for a frame view, e.g. of a mapped raw sequence (pixels are read without copying the frame) */
+	slimage::Image<Pixel<PixelRgbd>,1> DaspPixels(const RawFrameView& frame, const DaspCamera& camera, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial(),
+		float* density_scale=nullptr);
+
+	/** DASP stage 2: computes superpixel seeds from pixel density */
+	std::vector<Seed> DaspSeeds(const slimage::Image<Pixel<PixelRgbd>,1>& pixels, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** DASP stage 3: clusters pixels into superpixels */
+	Segmentation<PixelRgbd> DaspClustering(const slimage::Image<Pixel<PixelRgbd>,1>& pixels, const std::vector<Seed>& seeds, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Computes a mask of pixels which changed since the previous frame
+	 * A pixel changed if its validity changed or if color (in [0,1]) or depth (in meters) differ by more than the given thresholds.
+	 */
+	slimage::Image1ub DaspChangeMask(const Segmentation<PixelRgbd>& previous, const slimage::Image3ub& color, const slimage::Image1ui16& depth,
+		const DaspParameters& opt=DaspParameters(), float color_threshold=0.1f, float depth_threshold=0.02f, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Updates DASP superpixels of the previous frame where the new frame changed
+	 * Pixel features and superpixels are only recomputed close to pixels marked in 'changed',
+	 * all other superpixels are kept. The number of superpixels does not change.
+	 * Recomputed densities are scaled with previous.density_scale. See ALICUpdate for the used ALIC parameters.
+	 * The previous segmentation is copied, see the overload below for updating it in place.
+	 */
+	Segmentation<PixelRgbd> SuperpixelsDaspUpdate(const Segmentation<PixelRgbd>& previous, const slimage::Image3ub& color, const slimage::Image1ui16& depth,
+		const slimage::Image1ub& changed, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Updates DASP superpixels in place, reusing the images of the previous segmentation
+	 * The images of 'previous' must not be shared with other segmentations (slimage images share their pixels when copied).
+	 * Cost is proportional to the changed region.
+	 */
+	Segmentation<PixelRgbd> SuperpixelsDaspUpdate(Segmentation<PixelRgbd>&& previous, const slimage::Image3ub& color, const slimage::Image1ui16& depth,
+		const slimage::Image1ub& changed, const DaspParameters& opt=DaspParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
 }
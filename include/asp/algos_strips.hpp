@@ -0,0 +1,24 @@
+#pragma once
+
+#include <asp/algos.hpp>
+#include <asp/strips.hpp>
+#include <slimage/image.hpp>
+#include <functional>
+#include <vector>
+
+namespace asp
+{
+
+	/** Adaptive Superpixels for images which are too large to be held in memory
+	 * read_color and read_density must return the image rows [y_begin,y_end).
+	 * write_labels receives the superpixel ids for consecutive rows starting at y_begin.
+	 * See AlicStrips for the consistency at strip seams and the number of reads per strip.
+	 */
+	std::vector<Superpixel<PixelRgb>> SuperpixelsAspStrips(unsigned width, unsigned height,
+		const std::function<slimage::Image3ub(unsigned,unsigned)>& read_color,
+		const std::function<slimage::Image1f(unsigned,unsigned)>& read_density,
+		const std::function<void(unsigned,const slimage::Image<int,1>&)>& write_labels,
+		const AspParameters& opt=AspParameters(), const StripParameters& strip_opt=StripParameters(),
+		const ExecutionContext& exec=ExecutionContext::Serial());
+
+}
@@ -1,15 +1,54 @@
 #pragma once
 
 #include <asp/pds.hpp>
+#include <asp/density.hpp>
 #include <asp/segmentation.hpp>
 #include <asp/graph.hpp>
+#include <asp/execution.hpp>
+#include <asp/features.hpp>
+#include <asp/isa.hpp>
+#include <asp/mask.hpp>
 #include <vector>
 #include <tuple>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 
 namespace asp {
 
+/** Parameters for the ALIC algorithm */
+struct AlicParameters
+{
+	// number of iterations
+	unsigned iterations = 5;
+
+	// size of the superpixel search region relative to the superpixel radius
+	float lambda = 3.0f;
+
+	// if enabled iterations after the first one only re-evaluate pixels on superpixel borders
+	bool boundary_refinement = false;
+
+	// only every stride-th pixel in x and y is clustered (1 = all pixels)
+	// skipped pixels get the best label of their clustered neighbours in a final pass
+	// (superpixels with a radius close to the stride may lose all their pixels)
+	unsigned stride = 1;
+
+	// if enabled fragments of superpixels which are not connected to the largest part
+	// are given to the neighbouring superpixel with which they share the longest border
+	bool enforce_connectivity = false;
+
+	// time budget in milliseconds for the clustering iterations (0 = no limit)
+	// the first iteration is always completed, later iterations run while budget remains
+	// and an interrupted iteration is discarded (see Segmentation::iterations)
+	float time_budget_ms = 0.0f;
+
+	// inverse index from superpixels to their pixels which is built after the final labeling
+	MembershipIndex membership = MembershipIndex::None;
+};
+
 namespace detail
 {
 	inline
@@ -21,10 +60,135 @@ namespace detail
 		);
 	}
 
-	/** Compute superpixel radius from density */
+	/** Smallest multiple of step which is not smaller than x (x >= 0) */
 	inline
-	float DensityToRadius(float density)
-	{ return std::sqrt(1.0f / (density*3.1415f)); } // rho = 1 / (r*r*pi) => r = sqrt(rho/pi)
+	int AlignUp(int x, int step)
+	{ return ((x + step - 1) / step) * step; }
+
+	/** Spreads the lower 32 bits of x such that there is a zero bit between each bit */
+	inline
+	uint64_t MortonSpread(uint64_t x)
+	{
+		x &= 0x00000000FFFFFFFFull;
+		x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+		x = (x | (x <<  8)) & 0x00FF00FF00FF00FFull;
+		x = (x | (x <<  4)) & 0x0F0F0F0F0F0F0F0Full;
+		x = (x | (x <<  2)) & 0x3333333333333333ull;
+		x = (x | (x <<  1)) & 0x5555555555555555ull;
+		return x;
+	}
+
+	/** Morton code (Z-order curve index) of a 2D position */
+	inline
+	uint64_t MortonCode(const Eigen::Vector2f& position)
+	{
+		const uint64_t x = static_cast<uint64_t>(std::max(0.0f, position.x()));
+		const uint64_t y = static_cast<uint64_t>(std::max(0.0f, position.y()));
+		return MortonSpread(x) | (MortonSpread(y) << 1);
+	}
+
+	/** Computes an order of superpixels along a Z-order curve over their centers
+	 * Superpixels which are close in this order have overlapping bounding boxes
+	 * which gives much better cache reuse than seed order (which is scan-line order).
+	 */
+	template<typename T>
+	std::vector<size_t> ComputeTraversalOrder(const std::vector<Superpixel<T>>& superpixels)
+	{
+		std::vector<std::pair<uint64_t,size_t>> keys(superpixels.size());
+		for(size_t i=0; i<superpixels.size(); i++) {
+			keys[i] = std::make_pair(MortonCode(superpixels[i].position), i);
+		}
+		std::sort(keys.begin(), keys.end());
+		std::vector<size_t> order(keys.size());
+		for(size_t i=0; i<keys.size(); i++) {
+			order[i] = keys[i].second;
+		}
+		return order;
+	}
+
+	/** Point in time after which clustering stops (never expires if constructed without a budget) */
+	class Deadline
+	{
+	public:
+		Deadline()
+		:	enabled_(false)
+		{}
+
+		/** Expires budget_ms milliseconds from now, a budget which is not positive means no limit */
+		explicit Deadline(float budget_ms)
+		:	enabled_(budget_ms > 0.0f),
+			end_(std::chrono::steady_clock::now()
+				+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float,std::milli>(budget_ms)))
+		{}
+
+		bool enabled() const
+		{ return enabled_; }
+
+		bool expired() const
+		{ return enabled_ && std::chrono::steady_clock::now() >= end_; }
+
+	private:
+		bool enabled_;
+		std::chrono::steady_clock::time_point end_;
+	};
+
+	/** Row-wise runs of valid pixels in compressed sparse row layout
+	 * Used to skip invalid pixels (e.g. missing depth) without touching them.
+	 */
+	struct ValidSpans
+	{
+		// runs of row y are runs[row_begin[y]] to runs[row_begin[y+1]-1]
+		std::vector<size_t> row_begin;
+
+		// half-open pixel range [first,second) of a run
+		std::vector<std::pair<int,int>> runs;
+
+		/** Calls f(x) for each valid pixel x1 <= x < x2 in row y where x is a multiple of step */
+		template<typename F>
+		ASP_KERNEL void forEach(int y, int x1, int x2, F f, int step=1) const
+		{
+			auto it = runs.begin() + row_begin[y];
+			const auto last = runs.begin() + row_begin[y+1];
+			// skip runs which end before x1
+			it = std::upper_bound(it, last, x1,
+				[](int x, const std::pair<int,int>& r) { return x < r.second; });
+			for(; it != last && it->first < x2; ++it) {
+				const int xa = AlignUp(std::max(it->first, x1), step);
+				const int xb = std::min(it->second, x2);
+				for(int x=xa; x<xb; x+=step) {
+					f(x);
+				}
+			}
+		}
+	};
+
+	/** Computes runs of valid pixels */
+	template<typename T>
+	ValidSpans ComputeValidSpans(const slimage::Image<Pixel<T>,1>& input)
+	{
+		const int width = input.width();
+		const int height = input.height();
+		ValidSpans spans;
+		spans.row_begin.reserve(height + 1);
+		for(int y=0; y<height; y++) {
+			spans.row_begin.push_back(spans.runs.size());
+			int x = 0;
+			while(x < width) {
+				while(x < width && !input(x,y).valid()) {
+					x++;
+				}
+				const int xa = x;
+				while(x < width && input(x,y).valid()) {
+					x++;
+				}
+				if(xa < x) {
+					spans.runs.push_back(std::make_pair(xa, x));
+				}
+			}
+		}
+		spans.row_begin.push_back(spans.runs.size());
+		return spans;
+	}
 
 	/** Accumulate pixel data into superpixels */
 	template<typename T>
@@ -39,6 +203,18 @@ namespace detail
 		void add(const SegmentBase<T>& v)
 		{ sum_.accumulate(v); }
 
+		void remove(const SegmentBase<T>& v)
+		{ sum_.deaccumulate(v); }
+
+		/** Adds the sum of another accumulator */
+		void merge(const SegmentAccumulator& other)
+		{
+			sum_.num += other.sum_.num;
+			sum_.position += other.sum_.position;
+			sum_.density += other.sum_.density;
+			sum_.data.accumulate(other.sum_.data);
+		}
+
 		bool empty() const
 		{ return sum_.num == 0.0f; }
 
@@ -57,15 +233,553 @@ namespace detail
 		acc_t sum_;
 	};
 
+	/** Assigns each pixel on the stride grid to the closest superpixel in its search region (other pixels get -1)
+	 * The deadline is checked before each superpixel. Returns false if it expired, labels are incomplete in that case.
+	 */
+	template<typename T, typename F>
+	bool AlicAssign(Segmentation<T>& s, const ValidSpans& spans, F dist, const AlicParameters& opt, int stride, const ExecutionContext& exec,
+		const Deadline& deadline=Deadline())
+	{
+		const unsigned width = s.input.width();
+		const unsigned height = s.input.height();
+		const size_t num_bands = exec.numChunks(height);
+		// visit superpixels in a cache friendly order
+		// (superpixel ids are not changed, only the order in which they are visited)
+		const std::vector<size_t> order = ComputeTraversalOrder(s.superpixels);
+		std::atomic<bool> expired(false);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const int band_y1 = ChunkBegin(height, num_bands, band);
+			const int band_y2 = ChunkBegin(height, num_bands, band + 1);
+			// reset weights
+			std::fill(s.indices.begin() + band_y1*width, s.indices.begin() + band_y2*width, -1);
+			std::fill(s.weights.begin() + band_y1*width, s.weights.begin() + band_y2*width, std::numeric_limits<float>::max());
+			IsaDispatch([&]() ASP_KERNEL {
+				// iterate over all superpixels
+				for(size_t sid : order) {
+					if(deadline.enabled() && (expired.load(std::memory_order_relaxed) || deadline.expired())) {
+						expired.store(true, std::memory_order_relaxed);
+						break;
+					}
+					const auto& sp = s.superpixels[sid];
+					// compute superpixel bounding box (restricted to band)
+					int x1, x2, y1, y2;
+					std::tie(x1,x2) = GetRange(0, width, sp.position.x(), opt.lambda*sp.radius);
+					std::tie(y1,y2) = GetRange(band_y1, band_y2, sp.position.y(), opt.lambda*sp.radius);
+					// iterate over valid pixels in superpixel bounding box
+					for(int y=AlignUp(y1, stride); y<y2; y+=stride) {
+						spans.forEach(y, x1, x2, [&](int x) ASP_KERNEL {
+							float d = dist(sp, s.input(x,y));
+							// on ties prefer the smaller id to get the same result as for seed order
+							if(d < s.weights(x,y) || (d == s.weights(x,y) && static_cast<int>(sid) < s.indices(x,y))) {
+								s.weights(x,y) = d;
+								s.indices(x,y) = sid;
+							}
+						}, stride);
+					}
+				}
+			});
+		});
+		return !expired.load();
+	}
+
+	/** Accumulates pixels on the stride grid into their assigned superpixels and adds them to the feature collector */
+	template<typename T, typename S>
+	std::vector<SegmentAccumulator<T>> AlicAccumulate(const Segmentation<T>& s, const ValidSpans& spans, int stride, const ExecutionContext& exec, S& features)
+	{
+		const unsigned width = s.input.width();
+		const unsigned height = s.input.height();
+		const size_t num_bands = exec.numChunks(height);
+		std::vector<std::vector<SegmentAccumulator<T>>> band_acc(num_bands);
+		// the first band uses the given collector, all other bands a copy
+		features.resize(s.superpixels.size());
+		std::vector<S> band_features(num_bands - 1, features);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			auto& acc = band_acc[band];
+			S& f = (band == 0) ? features : band_features[band - 1];
+			acc.resize(s.superpixels.size(), SegmentAccumulator<T>{});
+			const unsigned band_y1 = ChunkBegin(height, num_bands, band);
+			const unsigned band_y2 = ChunkBegin(height, num_bands, band + 1);
+			IsaDispatch([&]() ASP_KERNEL {
+				for(unsigned y=AlignUp(band_y1, stride); y<band_y2; y+=stride) {
+					spans.forEach(y, 0, width, [&](int x) ASP_KERNEL {
+						int sid = s.indices(x,y);
+						if(sid >= 0) {
+							const auto& px = s.input(x,y);
+							acc[sid].add(px);
+							f.add(sid, x, y, px);
+						}
+					}, stride);
+				}
+			});
+		});
+		auto& acc = band_acc.front();
+		for(size_t band=1; band<num_bands; band++) {
+			for(size_t i=0; i<acc.size(); i++) {
+				acc[i].merge(band_acc[band][i]);
+			}
+			features.merge(band_features[band - 1]);
+		}
+		return std::move(acc);
+	}
+
+	/** Accumulates pixels on the stride grid into their assigned superpixels */
+	template<typename T>
+	std::vector<SegmentAccumulator<T>> AlicAccumulate(const Segmentation<T>& s, const ValidSpans& spans, int stride, const ExecutionContext& exec)
+	{
+		NoFeatures features;
+		return AlicAccumulate(s, spans, stride, exec, features);
+	}
+
+	/** Adds all assigned pixels to the feature collector */
+	template<typename T, typename S>
+	void AlicCollectFeatures(const Segmentation<T>& s, const ValidSpans& spans, const ExecutionContext& exec, S& features)
+	{
+		const unsigned width = s.input.width();
+		const unsigned height = s.input.height();
+		const size_t num_bands = exec.numChunks(height);
+		features.resize(s.superpixels.size());
+		std::vector<S> band_features(num_bands - 1, features);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			S& f = (band == 0) ? features : band_features[band - 1];
+			const unsigned band_y1 = ChunkBegin(height, num_bands, band);
+			const unsigned band_y2 = ChunkBegin(height, num_bands, band + 1);
+			for(unsigned y=band_y1; y<band_y2; y++) {
+				spans.forEach(y, 0, width, [&](int x) {
+					int sid = s.indices(x,y);
+					if(sid >= 0) {
+						f.add(sid, x, y, s.input(x,y));
+					}
+				});
+			}
+		});
+		for(size_t band=1; band<num_bands; band++) {
+			features.merge(band_features[band - 1]);
+		}
+	}
+
+	/** Nothing to collect without a feature collector */
+	template<typename T>
+	void AlicCollectFeatures(const Segmentation<T>&, const ValidSpans&, const ExecutionContext&, NoFeatures&)
+	{}
+
+	/** Label change of one pixel during boundary refinement */
+	struct PixelMove
+	{
+		int x, y;
+		int sid;
+		float weight;
+	};
+
+	/** Re-evaluates only pixels on superpixel borders against their neighbouring superpixels
+	 * Border pixels are found with the same 4-neighbour test as used for plotting borders
+	 * (neighbours are stride pixels apart).
+	 * Moved pixels are removed from and added to the superpixel sums incrementally.
+	 * The deadline is checked before each row. Returns false if it expired, no label is changed in that case.
+	 */
+	template<typename T, typename F>
+	bool AlicRefineBoundaries(Segmentation<T>& s, const ValidSpans& spans, std::vector<SegmentAccumulator<T>>& acc, F dist, int stride, const ExecutionContext& exec,
+		const Deadline& deadline=Deadline())
+	{
+		const int width = s.input.width();
+		const int height = s.input.height();
+		const size_t num_bands = exec.numChunks(height);
+		// find label changes (labels are not modified yet, so bands are independent)
+		std::vector<std::vector<PixelMove>> band_moves(num_bands);
+		std::atomic<bool> expired(false);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			auto& moves = band_moves[band];
+			const int band_y1 = ChunkBegin(height, num_bands, band);
+			const int band_y2 = ChunkBegin(height, num_bands, band + 1);
+			IsaDispatch([&]() ASP_KERNEL {
+				for(int y=AlignUp(band_y1, stride); y<band_y2; y+=stride) {
+					if(deadline.enabled() && (expired.load(std::memory_order_relaxed) || deadline.expired())) {
+						expired.store(true, std::memory_order_relaxed);
+						break;
+					}
+					const int ym = std::max(y-stride, 0);
+					const int yp = std::min(y+stride, height-1);
+					spans.forEach(y, 0, width, [&](int x) ASP_KERNEL {
+						const int xm = std::max(x-stride, 0);
+						const int xp = std::min(x+stride, width-1);
+						const int i = s.indices(x,y);
+						const int candidates[4] = {
+							s.indices(xm,y), s.indices(xp,y), s.indices(x,ym), s.indices(x,yp)
+						};
+						if(    i == candidates[0] && i == candidates[1]
+							&& i == candidates[2] && i == candidates[3]) {
+							return;
+						}
+						// test against current and adjacent superpixels
+						int best = i;
+						float best_weight = (i >= 0) ? dist(s.superpixels[i], s.input(x,y)) : std::numeric_limits<float>::max();
+						for(int c : candidates) {
+							if(c < 0 || c == i) {
+								continue;
+							}
+							const float d = dist(s.superpixels[c], s.input(x,y));
+							if(d < best_weight || (d == best_weight && c < best)) {
+								best = c;
+								best_weight = d;
+							}
+						}
+						if(best != i) {
+							moves.push_back({x, y, best, best_weight});
+						}
+						else {
+							s.weights(x,y) = best_weight;
+						}
+					}, stride);
+				}
+			});
+		});
+		if(expired.load()) {
+			return false;
+		}
+		// apply label changes and update superpixel sums
+		for(const auto& moves : band_moves) {
+			for(const PixelMove& m : moves) {
+				const int old_sid = s.indices(m.x, m.y);
+				const auto& px = s.input(m.x, m.y);
+				if(old_sid >= 0) {
+					acc[old_sid].remove(px);
+				}
+				acc[m.sid].add(px);
+				s.indices(m.x, m.y) = m.sid;
+				s.weights(m.x, m.y) = m.weight;
+			}
+		}
+		return true;
+	}
+
+	/** Assigns valid pixels which are not on the stride grid
+	 * Candidates are the labels of the four surrounding grid pixels and of the left neighbour,
+	 * the pixel gets the candidate with the smallest distance and thus follows image edges.
+	 * Pixels without a labelled candidate (e.g. next to invalid pixels) stay unassigned.
+	 */
+	template<typename T, typename F>
+	void AlicFillSkipped(Segmentation<T>& s, const ValidSpans& spans, F dist, int stride, const ExecutionContext& exec)
+	{
+		const int width = s.input.width();
+		const int height = s.input.height();
+		const size_t num_bands = exec.numChunks(height);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const int band_y1 = ChunkBegin(height, num_bands, band);
+			const int band_y2 = ChunkBegin(height, num_bands, band + 1);
+			for(int y=band_y1; y<band_y2; y++) {
+				// grid pixels are only read, thus bands are independent
+				const int gy1 = (y / stride) * stride;
+				const int gy2 = gy1 + stride;
+				const bool on_grid_row = (y == gy1);
+				auto grid_label = [&](int gx, int gy) {
+					return (gx < width && gy < height) ? s.indices(gx,gy) : -1;
+				};
+				spans.forEach(y, 0, width, [&](int x) {
+					const int gx1 = (x / stride) * stride;
+					if(on_grid_row && x == gx1) {
+						return;
+					}
+					const int gx2 = gx1 + stride;
+					const int candidates[5] = {
+						grid_label(gx1,gy1), grid_label(gx2,gy1), grid_label(gx1,gy2), grid_label(gx2,gy2),
+						(x > 0) ? s.indices(x-1,y) : -1
+					};
+					const auto& px = s.input(x,y);
+					int best = -1;
+					float best_weight = std::numeric_limits<float>::max();
+					for(int c : candidates) {
+						if(c < 0 || c == best) {
+							continue;
+						}
+						const float d = dist(s.superpixels[c], px);
+						if(d < best_weight || (d == best_weight && c < best)) {
+							best = c;
+							best_weight = d;
+						}
+					}
+					s.indices(x,y) = best;
+					s.weights(x,y) = best_weight;
+				});
+			}
+		});
+	}
+
+	/** Run of pixels with the same label in one row */
+	struct LabelRun
+	{
+		int x1, x2;
+		int label;
+	};
+
+	/** Union-find over row runs where the representative is the smallest run index */
+	struct RunForest
+	{
+		std::vector<int> parent;
+
+		int find(int i)
+		{
+			int root = i;
+			while(parent[root] != root) {
+				root = parent[root];
+			}
+			while(parent[i] != root) {
+				int next = parent[i];
+				parent[i] = root;
+				i = next;
+			}
+			return root;
+		}
+
+		void unite(int a, int b)
+		{
+			a = find(a);
+			b = find(b);
+			if(a < b) {
+				parent[b] = a;
+			}
+			else if(b < a) {
+				parent[a] = b;
+			}
+		}
+	};
+
+	/** Calls f(i,j,overlap) for each pair of runs i in row a and j in row b with overlapping x range */
+	template<typename F>
+	void ForEachRunOverlap(const std::vector<LabelRun>& runs, size_t a1, size_t a2, size_t b1, size_t b2, F f)
+	{
+		size_t i = a1, j = b1;
+		while(i < a2 && j < b2) {
+			const int overlap = std::min(runs[i].x2, runs[j].x2) - std::max(runs[i].x1, runs[j].x1);
+			if(overlap > 0) {
+				f(i, j, overlap);
+			}
+			if(runs[i].x2 < runs[j].x2) {
+				i++;
+			}
+			else {
+				j++;
+			}
+		}
+	}
+
+	/** Gives fragments of superpixels which are not their largest connected part to a neighbouring superpixel
+	 * Connected components (4-neighbourhood) are found with a union-find over row runs which is
+	 * applied in parallel within image bands and serially across band borders.
+	 * A fragment goes to the neighbouring superpixel (largest part only) with which it shares the
+	 * longest border. Fragments which only touch other fragments follow a neighbouring fragment
+	 * after it was moved. Fragments without any labeled neighbour keep their label.
+	 * Only moved pixels are visited a second time, superpixel sums are updated incrementally.
+	 */
+	template<typename T, typename F>
+	void AlicEnforceConnectivity(Segmentation<T>& s, std::vector<SegmentAccumulator<T>>& acc, F dist, const ExecutionContext& exec)
+	{
+		const int width = s.indices.width();
+		const int height = s.indices.height();
+		const size_t num_bands = exec.numChunks(height);
+		// row runs of equal labels
+		std::vector<std::vector<LabelRun>> band_runs(num_bands);
+		std::vector<size_t> row_size(height, 0);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			auto& runs = band_runs[band];
+			const int band_y1 = ChunkBegin(height, num_bands, band);
+			const int band_y2 = ChunkBegin(height, num_bands, band + 1);
+			for(int y=band_y1; y<band_y2; y++) {
+				const size_t size_before = runs.size();
+				int x = 0;
+				while(x < width) {
+					const int label = s.indices(x,y);
+					const int xa = x;
+					while(x < width && s.indices(x,y) == label) {
+						x++;
+					}
+					if(label >= 0) {
+						runs.push_back({xa, x, label});
+					}
+				}
+				row_size[y] = runs.size() - size_before;
+			}
+		});
+		std::vector<LabelRun> runs;
+		for(const auto& r : band_runs) {
+			runs.insert(runs.end(), r.begin(), r.end());
+		}
+		std::vector<size_t> row_begin(height + 1, 0);
+		for(int y=0; y<height; y++) {
+			row_begin[y+1] = row_begin[y] + row_size[y];
+		}
+		// connected components
+		RunForest forest;
+		forest.parent.resize(runs.size());
+		for(size_t i=0; i<runs.size(); i++) {
+			forest.parent[i] = i;
+		}
+		auto unite_rows = [&](int y) {
+			ForEachRunOverlap(runs, row_begin[y-1], row_begin[y], row_begin[y], row_begin[y+1],
+				[&](size_t i, size_t j, int) {
+					if(runs[i].label == runs[j].label) {
+						forest.unite(i, j);
+					}
+				});
+		};
+		// runs of a band are only linked to runs of the same band, thus bands are independent
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const int band_y1 = ChunkBegin(height, num_bands, band);
+			const int band_y2 = ChunkBegin(height, num_bands, band + 1);
+			for(int y=band_y1+1; y<band_y2; y++) {
+				unite_rows(y);
+			}
+		});
+		for(size_t band=1; band<num_bands; band++) {
+			const int y = ChunkBegin(height, num_bands, band);
+			if(0 < y && y < height) {
+				unite_rows(y);
+			}
+		}
+		// component sizes and largest component per label
+		std::vector<int> root(runs.size());
+		std::vector<size_t> size(runs.size(), 0);
+		for(size_t i=0; i<runs.size(); i++) {
+			root[i] = forest.find(i);
+			size[root[i]] += runs[i].x2 - runs[i].x1;
+		}
+		std::vector<int> largest(s.superpixels.size(), -1);
+		for(size_t i=0; i<runs.size(); i++) {
+			if(root[i] != static_cast<int>(i)) {
+				continue;
+			}
+			int& best = largest[runs[i].label];
+			if(best == -1 || size[i] > size[best]) {
+				best = i;
+			}
+		}
+		auto is_fragment = [&](size_t i) {
+			return largest[runs[i].label] != root[i];
+		};
+		// border length between fragments and largest components of other labels
+		// and between fragments of different labels (by component root)
+		std::vector<std::vector<std::pair<int,unsigned>>> contacts(runs.size());
+		std::vector<std::vector<std::pair<int,unsigned>>> fragment_contacts(runs.size());
+		bool has_fragments = false;
+		auto add_to = [](std::vector<std::pair<int,unsigned>>& v, int key, unsigned n) {
+			auto it = std::find_if(v.begin(), v.end(),
+				[key](const std::pair<int,unsigned>& q) { return q.first == key; });
+			if(it == v.end()) {
+				v.push_back(std::make_pair(key, n));
+			}
+			else {
+				it->second += n;
+			}
+		};
+		auto add_contact = [&](size_t i, size_t j, unsigned n) {
+			if(runs[i].label == runs[j].label || !is_fragment(i)) {
+				return;
+			}
+			if(is_fragment(j)) {
+				add_to(fragment_contacts[root[i]], root[j], n);
+			}
+			else {
+				has_fragments = true;
+				add_to(contacts[root[i]], runs[j].label, n);
+			}
+		};
+		for(int y=0; y<height; y++) {
+			for(size_t i=row_begin[y]; i+1<row_begin[y+1]; i++) {
+				if(runs[i].x2 == runs[i+1].x1) {
+					add_contact(i, i+1, 1);
+					add_contact(i+1, i, 1);
+				}
+			}
+			if(y > 0) {
+				ForEachRunOverlap(runs, row_begin[y-1], row_begin[y], row_begin[y], row_begin[y+1],
+					[&](size_t i, size_t j, int overlap) {
+						add_contact(i, j, overlap);
+						add_contact(j, i, overlap);
+					});
+			}
+		}
+		if(!has_fragments) {
+			return;
+		}
+		// move fragments to the neighbour with the longest border
+		std::vector<int> new_label(runs.size(), -1);
+		std::vector<int> pending;
+		for(size_t i=0; i<runs.size(); i++) {
+			unsigned best = 0;
+			for(const auto& q : contacts[i]) {
+				if(q.second > best || (q.second == best && q.first < new_label[i])) {
+					best = q.second;
+					new_label[i] = q.first;
+				}
+			}
+			if(new_label[i] == -1 && !fragment_contacts[i].empty()) {
+				pending.push_back(i);
+			}
+		}
+		// fragments which only touch other fragments follow a moved neighbouring fragment
+		// (which is connected to the largest part of its new superpixel) in rounds
+		while(!pending.empty()) {
+			std::vector<std::pair<int,int>> moved;
+			std::vector<int> still_pending;
+			for(int i : pending) {
+				unsigned best = 0;
+				int label = -1;
+				for(const auto& q : fragment_contacts[i]) {
+					const int ql = new_label[q.first];
+					if(ql != -1 && (q.second > best || (q.second == best && ql < label))) {
+						best = q.second;
+						label = ql;
+					}
+				}
+				if(label == -1) {
+					still_pending.push_back(i);
+				}
+				else {
+					moved.push_back(std::make_pair(i, label));
+				}
+			}
+			if(moved.empty()) {
+				break;
+			}
+			for(const auto& m : moved) {
+				new_label[m.first] = m.second;
+			}
+			pending.swap(still_pending);
+		}
+		for(int y=0; y<height; y++) {
+			for(size_t i=row_begin[y]; i<row_begin[y+1]; i++) {
+				const int label = new_label[root[i]];
+				if(label == -1) {
+					continue;
+				}
+				for(int x=runs[i].x1; x<runs[i].x2; x++) {
+					const auto& px = s.input(x,y);
+					acc[runs[i].label].remove(px);
+					acc[label].add(px);
+					s.indices(x,y) = label;
+					s.weights(x,y) = dist(s.superpixels[label], px);
+				}
+			}
+		}
+	}
+
 }
 
 
-/** Adaptive Local Iterative Clustering superpixel algorithm */
-template<typename T, typename F>
-Segmentation<T> ALIC(const slimage::Image<Pixel<T>,1>& input, const std::vector<Seed>& seeds, F dist)
+/** Adaptive Local Iterative Clustering superpixel algorithm
+ * The image is split into horizontal bands which are processed in parallel using the given execution context.
+ * Only valid pixels are visited, thus scan cost scales with the number of valid pixels.
+ * The optional feature collector (see features.hpp) always receives all pixels with their final labels
+ * (none are assigned if opt.iterations is 0). It is filled during the last accumulation pass if possible
+ * and needs an extra pass otherwise, e.g. with boundary refinement.
+ * With a time budget the clock is checked before each superpixel (each row for boundary refinement),
+ * an interrupted iteration keeps the labels of the previous one and sets Segmentation::deadline_exceeded.
+ * Superpixel densities are the mean pixel densities multiplied with density_scale
+ * (e.g. for several superpixel counts from the same pixels, seeds must use the same factor).
+ */
+template<typename T, typename F, typename S=NoFeatures>
+Segmentation<T> ALIC(const slimage::Image<Pixel<T>,1>& input, const std::vector<Seed>& seeds, F dist,
+	const AlicParameters& opt=AlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial(),
+	S&& features=S(), float density_scale=1.0f)
 {
-	constexpr unsigned ITERATIONS = 5;
-	constexpr float LAMBDA = 3.0f;
 	const unsigned width = input.width();
 	const unsigned height = input.height();
 	// initialize
@@ -84,51 +798,301 @@ Segmentation<T> ALIC(const slimage::Image<Pixel<T>,1>& input, const std::vector<
 	}
 	s.indices = slimage::Image<int,1>{width, height};
 	s.weights = slimage::Image1f{width, height};
+	const detail::ValidSpans spans = detail::ComputeValidSpans(input);
 	// iterate
-	for(unsigned k=0; k<ITERATIONS; k++) {
-		// reset weights
+	const int stride = std::max<int>(opt.stride, 1);
+	std::vector<detail::SegmentAccumulator<T>> acc;
+	auto update_superpixels = [&s,&acc,density_scale]() {
+		for(size_t i=0; i<s.superpixels.size(); i++) {
+			auto& sp = s.superpixels[i];
+			reinterpret_cast<SegmentBase<T>&>(sp) = acc[i].mean();
+			sp.density *= density_scale;
+			sp.radius = detail::DensityToRadius(sp.density);
+		}
+	};
+	// the first iteration always completes such that there is a valid labeling
+	const detail::Deadline deadline(opt.time_budget_ms);
+	std::vector<int> previous_indices;
+	std::vector<float> previous_weights;
+	// true once the feature collector received the final labels
+	bool features_collected = false;
+	if(opt.iterations == 0) {
+		// no clustering: no pixel is assigned
 		std::fill(s.indices.begin(), s.indices.end(), -1);
 		std::fill(s.weights.begin(), s.weights.end(), std::numeric_limits<float>::max());
-		// iterate over all superpixels
-		for(size_t sid=0; sid<s.superpixels.size(); sid++) {
-			const auto& sp = s.superpixels[sid];
-			// compute superpixel bounding box
-			int x1, x2, y1, y2;
-			std::tie(x1,x2) = detail::GetRange(0,  width, sp.position.x(), LAMBDA*sp.radius);
-			std::tie(y1,y2) = detail::GetRange(0, height, sp.position.y(), LAMBDA*sp.radius);
-			// iterate over superpixel bounding box
-			for(int y=y1; y<y2; y++) {
-				for(int x=x1; x<x2; x++) {
-					const auto& val = input(x,y);
-					if(!val.valid()) {
-						continue;
-					}
-					float d = dist(sp, val);
-					if(d < s.weights(x,y)) {
-						s.weights(x,y) = d;
-						s.indices(x,y) = sid;
-					}
+	}
+	for(unsigned k=0; k<opt.iterations; k++) {
+		// labels of the last iteration are final unless skipped pixels are filled in afterwards
+		const bool is_final = (k + 1 == opt.iterations) && stride == 1 && !opt.enforce_connectivity;
+		const detail::Deadline& iteration_deadline = (k > 0) ? deadline : detail::Deadline();
+		if(opt.boundary_refinement && k > 0) {
+			if(!detail::AlicRefineBoundaries(s, spans, acc, dist, stride, exec, iteration_deadline)) {
+				s.deadline_exceeded = true;
+				break;
+			}
+			if(is_final) {
+				detail::AlicCollectFeatures(s, spans, exec, features);
+				features_collected = true;
+			}
+		}
+		else {
+			if(iteration_deadline.enabled()) {
+				// keep labels of the previous iteration in case this one is interrupted
+				previous_indices.assign(s.indices.begin(), s.indices.end());
+				previous_weights.assign(s.weights.begin(), s.weights.end());
+			}
+			if(!detail::AlicAssign(s, spans, dist, opt, stride, exec, iteration_deadline)) {
+				// superpixels are still the means of the previous labels
+				std::copy(previous_indices.begin(), previous_indices.end(), s.indices.begin());
+				std::copy(previous_weights.begin(), previous_weights.end(), s.weights.begin());
+				s.deadline_exceeded = true;
+				break;
+			}
+			if(is_final) {
+				acc = detail::AlicAccumulate(s, spans, 1, exec, features);
+				features_collected = true;
+			}
+			else {
+				acc = detail::AlicAccumulate(s, spans, stride, exec);
+			}
+		}
+		update_superpixels();
+		s.iterations = k + 1;
+	}
+	if(stride > 1 && opt.iterations > 0) {
+		// label skipped pixels and compute superpixels from all pixels
+		detail::AlicFillSkipped(s, spans, dist, stride, exec);
+		if(opt.enforce_connectivity) {
+			acc = detail::AlicAccumulate(s, spans, 1, exec);
+		}
+		else {
+			acc = detail::AlicAccumulate(s, spans, 1, exec, features);
+			features_collected = true;
+		}
+		update_superpixels();
+	}
+	if(opt.enforce_connectivity && opt.iterations > 0) {
+		detail::AlicEnforceConnectivity(s, acc, dist, exec);
+		detail::AlicCollectFeatures(s, spans, exec, features);
+		features_collected = true;
+		update_superpixels();
+	}
+	if(!features_collected) {
+		// e.g. without iterations or if the time budget skipped the last iteration
+		detail::AlicCollectFeatures(s, spans, exec, features);
+	}
+	if(opt.membership != MembershipIndex::None) {
+		s.membership = ComputeMembership(s.indices, s.superpixels.size(), opt.membership, exec);
+	}
+	return s;
+}
+
+
+/** Recomputes the superpixels of an existing segmentation in a changed region (in place)
+ * 'previous' is the segmentation of the last frame whose input already holds the pixels of the new frame
+ * (at least all pixels which changed) and 'dirty' marks changed pixels with non-zero values.
+ * Only superpixels whose search region contains a dirty pixel are clustered again. Pixels in their
+ * search regions which belonged to them (or to no superpixel) in the previous segmentation are labeled again.
+ * Pixels of these superpixels outside of all such search regions keep their label and still contribute to the mean
+ * if they are within twice the search radius (ALIC does not label pixels further away).
+ * All other superpixels and their pixels are kept. The number of superpixels does not change.
+ * Apart from finding the bounding box of the dirty pixels and rebuilding a requested membership index,
+ * cost is proportional to the area of the search regions of the dirty superpixels.
+ *
+ * Of the ALIC parameters iterations, lambda, time_budget_ms and membership are used.
+ * With a time budget the clock is checked before each iteration after the first one.
+ * stride and boundary_refinement have no effect as only the pixels which may change are visited anyway,
+ * enforce_connectivity is not applied as it would relabel kept superpixels.
+ */
+template<typename T, typename F>
+Segmentation<T> ALICUpdate(Segmentation<T>&& previous, const slimage::Image1ub& dirty, F dist,
+	const AlicParameters& opt=AlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial())
+{
+	Segmentation<T> s = std::move(previous);
+	const int width = s.input.width();
+	const int height = s.input.height();
+	s.iterations = 0;
+	s.deadline_exceeded = false;
+	auto finish = [&s,&opt,&exec]() {
+		if(opt.membership != MembershipIndex::None) {
+			s.membership = ComputeMembership(s.indices, s.superpixels.size(), opt.membership, exec);
+		}
+		else {
+			s.membership = SuperpixelMembership();
+		}
+		return std::move(s);
+	};
+	const Roi change = MaskBoundingBox(dirty, exec);
+	if(change.empty()) {
+		return finish();
+	}
+	// integral image of dirty pixels in the bounding box for counting dirty pixels in a box
+	const int cx = change.x, cy = change.y;
+	const int cw = change.width, ch = change.height;
+	std::vector<unsigned> integral((cw + 1)*(ch + 1), 0);
+	for(int y=0; y<ch; y++) {
+		unsigned row_sum = 0;
+		for(int x=0; x<cw; x++) {
+			row_sum += (dirty(cx + x, cy + y) != 0) ? 1 : 0;
+			integral[(y + 1)*(cw + 1) + x + 1] = integral[y*(cw + 1) + x + 1] + row_sum;
+		}
+	}
+	auto num_dirty = [&integral,cx,cy,cw,ch](int x1, int x2, int y1, int y2) -> unsigned {
+		x1 = std::min(std::max(x1 - cx, 0), cw);
+		x2 = std::min(std::max(x2 - cx, x1), cw);
+		y1 = std::min(std::max(y1 - cy, 0), ch);
+		y2 = std::min(std::max(y2 - cy, y1), ch);
+		return integral[y2*(cw + 1) + x2] - integral[y1*(cw + 1) + x2]
+			- integral[y2*(cw + 1) + x1] + integral[y1*(cw + 1) + x1];
+	};
+	auto search_region = [&opt,width,height](const Superpixel<T>& sp, float scale) {
+		int x1, x2, y1, y2;
+		std::tie(x1,x2) = detail::GetRange(0, width, sp.position.x(), scale*opt.lambda*sp.radius);
+		std::tie(y1,y2) = detail::GetRange(0, height, sp.position.y(), scale*opt.lambda*sp.radius);
+		return std::make_tuple(x1, x2, y1, y2);
+	};
+	// find superpixels with dirty pixels in their search region (slot is the index into dirty_ids or -1)
+	// and the box [sx1,sx2) x [sy1,sy2) which contains all pixels these superpixels may have
+	std::vector<size_t> dirty_ids;
+	std::vector<int> slot(s.superpixels.size(), -1);
+	int sx1 = width, sx2 = 0, sy1 = height, sy2 = 0;
+	for(size_t sid=0; sid<s.superpixels.size(); sid++) {
+		int x1, x2, y1, y2;
+		std::tie(x1,x2,y1,y2) = search_region(s.superpixels[sid], 1.0f);
+		if(x1 < x2 && y1 < y2 && num_dirty(x1, x2, y1, y2) > 0) {
+			slot[sid] = static_cast<int>(dirty_ids.size());
+			dirty_ids.push_back(sid);
+			std::tie(x1,x2,y1,y2) = search_region(s.superpixels[sid], 2.0f);
+			sx1 = std::min(sx1, x1);
+			sx2 = std::max(sx2, x2);
+			sy1 = std::min(sy1, y1);
+			sy2 = std::max(sy2, y2);
+		}
+	}
+	if(dirty_ids.empty()) {
+		return finish();
+	}
+	const int sw = sx2 - sx1;
+	const int sh = sy2 - sy1;
+	// pixels of the box in the search region of a dirty superpixel
+	std::vector<unsigned char> in_region(sw*sh, 0);
+	for(size_t sid : dirty_ids) {
+		int x1, x2, y1, y2;
+		std::tie(x1,x2,y1,y2) = search_region(s.superpixels[sid], 1.0f);
+		for(int y=y1; y<y2; y++) {
+			std::fill(in_region.begin() + (y - sy1)*sw + x1 - sx1, in_region.begin() + (y - sy1)*sw + x2 - sx1, 1);
+		}
+	}
+	// per band of the box: pixels which may change their label (free) and the sum of the pixels
+	// of dirty superpixels which keep their label because they are outside of all search regions
+	const size_t num_bands = exec.numChunks(sh);
+	std::vector<unsigned char> is_free(sw*sh, 0);
+	std::vector<std::vector<std::pair<int,int>>> band_free(num_bands);
+	std::vector<std::vector<detail::SegmentAccumulator<T>>> band_kept(num_bands);
+	exec.parallel_for(num_bands, [&](size_t band) {
+		const int y1 = sy1 + detail::ChunkBegin(sh, num_bands, band);
+		const int y2 = sy1 + detail::ChunkBegin(sh, num_bands, band + 1);
+		auto& kept = band_kept[band];
+		kept.resize(dirty_ids.size(), detail::SegmentAccumulator<T>{});
+		for(int y=y1; y<y2; y++) {
+			for(int x=sx1; x<sx2; x++) {
+				const int prev_sid = s.indices(x,y);
+				if(prev_sid >= 0 && slot[prev_sid] < 0) {
+					continue;
+				}
+				const int i = (y - sy1)*sw + x - sx1;
+				if(in_region[i]) {
+					is_free[i] = 1;
+					band_free[band].push_back(std::make_pair(x, y));
+				}
+				else if(prev_sid >= 0 && s.input(x,y).valid()) {
+					kept[slot[prev_sid]].add(s.input(x,y));
 				}
 			}
 		}
-		// update superpixels
-		std::vector<detail::SegmentAccumulator<T>> acc(s.superpixels.size(), detail::SegmentAccumulator<T>{});
-		for(unsigned y=0; y<s.indices.height(); y++) {
-			for(unsigned x=0; x<s.indices.width(); x++) {
-				int sid = s.indices(x,y);
+	});
+	std::vector<detail::SegmentAccumulator<T>> kept_acc = std::move(band_kept.front());
+	for(size_t band=1; band<num_bands; band++) {
+		for(size_t i=0; i<kept_acc.size(); i++) {
+			kept_acc[i].merge(band_kept[band][i]);
+		}
+	}
+	// iterate only dirty superpixels and free pixels
+	const detail::Deadline deadline(opt.time_budget_ms);
+	for(unsigned k=0; k<opt.iterations; k++) {
+		if(k > 0 && deadline.expired()) {
+			s.deadline_exceeded = true;
+			break;
+		}
+		std::vector<std::vector<detail::SegmentAccumulator<T>>> band_acc(num_bands);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const int band_y1 = sy1 + detail::ChunkBegin(sh, num_bands, band);
+			const int band_y2 = sy1 + detail::ChunkBegin(sh, num_bands, band + 1);
+			for(const auto& p : band_free[band]) {
+				s.indices(p.first, p.second) = -1;
+				s.weights(p.first, p.second) = std::numeric_limits<float>::max();
+			}
+			for(size_t sid : dirty_ids) {
+				const auto& sp = s.superpixels[sid];
+				int x1, x2, y1, y2;
+				std::tie(x1,x2,y1,y2) = search_region(sp, 1.0f);
+				// superpixels only move within the box of their previous search region
+				x1 = std::max(x1, sx1);
+				x2 = std::min(x2, sx2);
+				for(int y=std::max(y1, band_y1); y<std::min(y2, band_y2); y++) {
+					for(int x=x1; x<x2; x++) {
+						const auto& val = s.input(x,y);
+						if(!is_free[(y - sy1)*sw + x - sx1] || !val.valid()) {
+							continue;
+						}
+						float d = dist(sp, val);
+						if(d < s.weights(x,y) || (d == s.weights(x,y) && static_cast<int>(sid) < s.indices(x,y))) {
+							s.weights(x,y) = d;
+							s.indices(x,y) = sid;
+						}
+					}
+				}
+			}
+			auto& acc = band_acc[band];
+			acc.resize(dirty_ids.size(), detail::SegmentAccumulator<T>{});
+			for(const auto& p : band_free[band]) {
+				const int sid = s.indices(p.first, p.second);
 				if(sid >= 0) {
-					acc[sid].add(input(x,y));
+					acc[slot[sid]].add(s.input(p.first, p.second));
 				}
 			}
-		}
-		for(size_t i=0; i<s.superpixels.size(); i++) {
-			auto& sp = s.superpixels[i];
-			reinterpret_cast<SegmentBase<T>&>(sp) = acc[i].mean();
+		});
+		for(size_t i=0; i<dirty_ids.size(); i++) {
+			detail::SegmentAccumulator<T> acc = kept_acc[i];
+			for(size_t band=0; band<num_bands; band++) {
+				acc.merge(band_acc[band][i]);
+			}
+			auto& sp = s.superpixels[dirty_ids[i]];
+			reinterpret_cast<SegmentBase<T>&>(sp) = acc.mean();
 			sp.radius = detail::DensityToRadius(sp.density);
 		}
+		s.iterations = k + 1;
 	}
-	return s;
+	return finish();
 }
 
+/** Recomputes the superpixels of an existing segmentation for a new frame (see ALICUpdate above)
+ * 'input' holds the pixels of the new frame. Labels and weights of 'previous' are copied,
+ * use the in-place version to avoid the copies.
+ */
+template<typename T, typename F>
+Segmentation<T> ALICUpdate(const Segmentation<T>& previous, const slimage::Image<Pixel<T>,1>& input, const slimage::Image1ub& dirty, F dist,
+	const AlicParameters& opt=AlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial())
+{
+	Segmentation<T> s;
+	s.input = input;
+	s.superpixels = previous.superpixels;
+	s.indices = slimage::Image<int,1>{input.width(), input.height()};
+	std::copy(previous.indices.begin(), previous.indices.end(), s.indices.begin());
+	s.weights = slimage::Image1f{input.width(), input.height()};
+	std::copy(previous.weights.begin(), previous.weights.end(), s.weights.begin());
+	s.density_scale = previous.density_scale;
+	return ALICUpdate(std::move(s), dirty, dist, opt, exec);
+}
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace asp {
+
+namespace detail
+{
+	/** Compute superpixel radius from density */
+	inline
+	float DensityToRadius(float density)
+	{ return std::sqrt(1.0f / (density*3.1415f)); } // rho = 1 / (r*r*pi) => r = sqrt(rho/pi)
+}
+
+/** Summed area table of a superpixel density function
+ * The density sum over a region is the expected number of superpixels in this region.
+ * Box sums are computed in O(1). Seeding uses it for the total density (grid sampling)
+ * and to average the seed density over the seed footprint.
+ * Optionally a validity mask is given: box sums and means then only cover valid pixels,
+ * while the total still covers all pixels, as it is the density which is sampled.
+ */
+class DensityIntegral
+{
+public:
+	using ValidMask = Eigen::Matrix<bool,Eigen::Dynamic,Eigen::Dynamic>;
+
+	DensityIntegral()
+	:	width_(0), height_(0), total_(0.0), table_(1, 0.0)
+	{}
+
+	/** Builds the table for a density function indexed as density(x,y) (all pixels are valid) */
+	explicit DensityIntegral(const Eigen::MatrixXf& density)
+	:	DensityIntegral(density, ValidMask())
+	{}
+
+	/** Builds the table for the pixels where valid(x,y) is true (an empty mask marks all pixels valid) */
+	DensityIntegral(const Eigen::MatrixXf& density, const ValidMask& valid)
+	:	width_(density.rows()), height_(density.cols()), total_(0.0),
+		table_((width_ + 1)*(height_ + 1), 0.0)
+	{
+		const bool all_valid = (valid.size() == 0);
+		if(!all_valid) {
+			count_.resize((width_ + 1)*(height_ + 1), 0);
+		}
+		for(int y=0; y<height_; y++) {
+			double row_sum = 0.0;
+			unsigned row_count = 0;
+			for(int x=0; x<width_; x++) {
+				const double v = static_cast<double>(density(x,y));
+				total_ += v;
+				if(all_valid || valid(x,y)) {
+					row_sum += v;
+					row_count++;
+				}
+				table_[(y + 1)*(width_ + 1) + x + 1] = table_[y*(width_ + 1) + x + 1] + row_sum;
+				if(!all_valid) {
+					count_[(y + 1)*(width_ + 1) + x + 1] = count_[y*(width_ + 1) + x + 1] + row_count;
+				}
+			}
+		}
+	}
+
+	int width() const
+	{ return width_; }
+
+	int height() const
+	{ return height_; }
+
+	/** Total density of all pixels (expected number of superpixels in the image) */
+	double total() const
+	{ return total_; }
+
+	/** Density sum over valid pixels x1 <= x < x2 and y1 <= y < y2 (clamped to the image) */
+	double sum(int x1, int x2, int y1, int y2) const
+	{
+		clamp(x1, x2, y1, y2);
+		return boxSum(table_, x1, x2, y1, y2);
+	}
+
+	/** Number of valid pixels x1 <= x < x2 and y1 <= y < y2 (clamped to the image) */
+	unsigned count(int x1, int x2, int y1, int y2) const
+	{
+		clamp(x1, x2, y1, y2);
+		return count_.empty()
+			? static_cast<unsigned>((x2 - x1)*(y2 - y1))
+			: boxSum(count_, x1, x2, y1, y2);
+	}
+
+	/** Mean density over valid pixels x1 <= x < x2 and y1 <= y < y2 (clamped to the image, 0 if there are none) */
+	float mean(int x1, int x2, int y1, int y2) const
+	{
+		const unsigned n = count(x1, x2, y1, y2);
+		return (n > 0) ? static_cast<float>(sum(x1, x2, y1, y2) / static_cast<double>(n)) : 0.0f;
+	}
+
+	/** Mean density over the valid pixels in the footprint of a superpixel with the given center and density */
+	float footprintMean(const Eigen::Vector2f& center, float density) const
+	{
+		if(density <= 0.0f) {
+			return density;
+		}
+		const float r = detail::DensityToRadius(density);
+		return mean(
+			clampFloor(center.x() - r, width_), clampCeil(center.x() + r, width_),
+			clampFloor(center.y() - r, height_), clampCeil(center.y() + r, height_));
+	}
+
+private:
+	void clamp(int& x1, int& x2, int& y1, int& y2) const
+	{
+		x1 = std::min(std::max(x1, 0), width_);
+		x2 = std::min(std::max(x2, x1), width_);
+		y1 = std::min(std::max(y1, 0), height_);
+		y2 = std::min(std::max(y2, y1), height_);
+	}
+
+	template<typename V>
+	V boxSum(const std::vector<V>& t, int x1, int x2, int y1, int y2) const
+	{
+		return t[y2*(width_ + 1) + x2] - t[y1*(width_ + 1) + x2]
+			- t[y2*(width_ + 1) + x1] + t[y1*(width_ + 1) + x1];
+	}
+
+	static int clampFloor(float v, int n)
+	{ return static_cast<int>(std::floor(std::min(std::max(v, 0.0f), static_cast<float>(n)))); }
+
+	static int clampCeil(float v, int n)
+	{ return static_cast<int>(std::ceil(std::min(std::max(v, 0.0f), static_cast<float>(n)))); }
+
+	int width_, height_;
+	double total_;
+	std::vector<double> table_;
+	std::vector<unsigned> count_; // empty if all pixels are valid
+};
+
+}
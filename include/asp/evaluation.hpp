@@ -0,0 +1,68 @@
+#pragma once
+
+#include <asp/segmentation.hpp>
+#include <asp/execution.hpp>
+#include <slimage/image.hpp>
+
+namespace asp
+{
+
+	/** Parameters for superpixel quality metrics */
+	struct EvaluationParameters
+	{
+		// maximal distance in pixels (chessboard metric) at which a ground truth boundary counts as recalled
+		unsigned boundary_tolerance = 2;
+	};
+
+	/** Superpixel quality metrics
+	 * Pixels with a negative superpixel or ground truth label are ignored.
+	 */
+	struct EvaluationResult
+	{
+		// fraction of ground truth boundary pixels with a superpixel boundary nearby (higher is better)
+		float boundary_recall;
+
+		// leakage of superpixels over ground truth segments (lower is better)
+		float undersegmentation_error;
+
+		// accuracy if each superpixel is labelled with its best ground truth segment (higher is better)
+		float achievable_segmentation_accuracy;
+
+		// area weighted isoperimetric quotient of superpixels (higher is better)
+		float compactness;
+
+		// number of superpixels with at least one pixel of valid ground truth
+		unsigned num_superpixels;
+	};
+
+	/** Fraction of ground truth boundary pixels which have a superpixel boundary pixel within the tolerance */
+	float BoundaryRecall(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth,
+		unsigned tolerance=2, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Undersegmentation error: sum over superpixels and overlapping ground truth segments
+	 * of min(overlap, superpixel size - overlap) divided by the number of pixels
+	 */
+	float UndersegmentationError(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth,
+		const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Achievable segmentation accuracy: sum over superpixels of the largest overlap with
+	 * a ground truth segment divided by the number of pixels
+	 */
+	float AchievableSegmentationAccuracy(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth,
+		const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Compactness: sum over superpixels of 4*pi*area/perimeter^2 weighted by area */
+	float Compactness(const slimage::Image<int,1>& labels, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Computes all metrics with one label pair histogram
+	 * All metrics run in time linear in the number of pixels.
+	 */
+	EvaluationResult Evaluate(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth,
+		const EvaluationParameters& opt=EvaluationParameters(), const ExecutionContext& exec=ExecutionContext::Serial());
+
+	template<typename T>
+	EvaluationResult Evaluate(const Segmentation<T>& seg, const slimage::Image<int,1>& ground_truth,
+		const EvaluationParameters& opt=EvaluationParameters(), const ExecutionContext& exec=ExecutionContext::Serial())
+	{ return Evaluate(seg.indices, ground_truth, opt, exec); }
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <cstddef>
+
+namespace asp
+{
+
+	/** Controls how libasp runs parallel loops
+	 * An execution context either runs everything in the calling thread,
+	 * owns a thread pool or forwards tasks to an executor supplied by the caller.
+	 * The owned pool is a plain shared task queue (no per-worker queues or stealing);
+	 * load balancing comes from parallel_for handing out single iterations.
+	 * One context can be shared by all stages and by several threads of the caller.
+	 */
+	class ExecutionContext
+	{
+	public:
+		/** Function which runs a task asynchronously, e.g. by posting it to a thread pool of the caller */
+		using Executor = std::function<void(std::function<void()>)>;
+
+		/** Strictly serial execution in the calling thread */
+		static const ExecutionContext& Serial();
+
+		/** Creates a context which owns a thread pool (num_threads=0 uses one thread per core, num_threads=1 is serial) */
+		explicit ExecutionContext(unsigned num_threads=0);
+
+		/** Creates a context which forwards tasks to an executor of the caller running up to 'concurrency' tasks at once */
+		ExecutionContext(Executor executor, unsigned concurrency);
+
+		/** Maximal number of tasks which run concurrently */
+		unsigned concurrency() const;
+
+		/** True if all work is done in the calling thread */
+		bool serial() const
+		{ return concurrency() <= 1; }
+
+		/** Number of chunks a loop over n items is split into
+		 * Only depends on n and not on the number of threads, thus results which are merged
+		 * chunk by chunk (e.g. floating point sums) are the same for every context.
+		 */
+		size_t numChunks(size_t n) const;
+
+		/** Calls f(i) for all i in [0,n)
+		 * Iterations are claimed dynamically by the calling thread and by idle workers.
+		 * Returns after all iterations are done. Calls may be nested.
+		 * If f throws, iterations which have not started yet are skipped and the
+		 * first exception is rethrown in the calling thread.
+		 */
+		void parallel_for(size_t n, const std::function<void(size_t)>& f) const;
+
+	private:
+		struct Impl;
+		std::shared_ptr<Impl> impl_;
+	};
+
+	namespace detail
+	{
+		/** Splits [0,n) into 'num' consecutive ranges and returns the begin of range i */
+		inline
+		size_t ChunkBegin(size_t n, size_t num, size_t i)
+		{ return (n * i) / num; }
+	}
+
+}
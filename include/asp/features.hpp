@@ -0,0 +1,190 @@
+#pragma once
+
+#include <asp/segmentation.hpp>
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace asp {
+
+/* Per-superpixel features which are gathered during the final accumulation pass of ALIC.
+ * A feature collector has the following members:
+ *   void resize(size_t num_superpixels)            -- clears and prepares statistics for all superpixels
+ *   void add(int sid, int x, int y, const Pixel<T>& px) -- adds pixel (x,y) which is assigned to superpixel sid
+ *   void merge(const Collector& other)             -- adds the statistics of another collector
+ * For parallel execution collectors are copied per image band and merged afterwards.
+ * Several collectors can be combined by a user defined collector which forwards to its members.
+ */
+
+/** Collector which does not gather any features */
+struct NoFeatures
+{
+	void resize(size_t)
+	{}
+
+	template<typename P>
+	void add(int, int, int, const P&)
+	{}
+
+	void merge(const NoFeatures&)
+	{}
+};
+
+/** Pixel bounding box of each superpixel */
+struct BoundingBoxFeatures
+{
+	/** Box with pixels x1 <= x < x2 and y1 <= y < y2 */
+	struct Box
+	{
+		int x1, x2, y1, y2;
+
+		bool empty() const
+		{ return x2 <= x1 || y2 <= y1; }
+	};
+
+	std::vector<Box> boxes;
+
+	void resize(size_t n)
+	{
+		const int max = std::numeric_limits<int>::max();
+		const int min = std::numeric_limits<int>::min();
+		boxes.assign(n, Box{max, min, max, min});
+	}
+
+	template<typename P>
+	void add(int sid, int x, int y, const P&)
+	{
+		Box& b = boxes[sid];
+		b.x1 = std::min(b.x1, x);
+		b.x2 = std::max(b.x2, x + 1);
+		b.y1 = std::min(b.y1, y);
+		b.y2 = std::max(b.y2, y + 1);
+	}
+
+	void merge(const BoundingBoxFeatures& other)
+	{
+		for(size_t i=0; i<boxes.size(); i++) {
+			Box& b = boxes[i];
+			const Box& o = other.boxes[i];
+			b.x1 = std::min(b.x1, o.x1);
+			b.x2 = std::max(b.x2, o.x2);
+			b.y1 = std::min(b.y1, o.y1);
+			b.y2 = std::max(b.y2, o.y2);
+		}
+	}
+};
+
+/** First and second moments of a per-pixel feature vector for each superpixel
+ * G maps (x, y, pixel) to an Eigen::Matrix<float,N,1>, e.g. the pixel position for
+ * shape covariances or the 3D point of a RGB-D pixel for surface covariances.
+ * Sums are accumulated in double precision.
+ */
+template<int N, typename G>
+struct MomentFeatures
+{
+	using vector_t = Eigen::Matrix<double,N,1>;
+	using matrix_t = Eigen::Matrix<double,N,N>;
+
+	G get;
+	std::vector<double> count;
+	std::vector<vector_t, Eigen::aligned_allocator<vector_t>> sum;
+	std::vector<matrix_t, Eigen::aligned_allocator<matrix_t>> sum_sq;
+
+	explicit MomentFeatures(G get)
+	:	get(get)
+	{}
+
+	void resize(size_t n)
+	{
+		count.assign(n, 0.0);
+		sum.assign(n, vector_t::Zero());
+		sum_sq.assign(n, matrix_t::Zero());
+	}
+
+	template<typename P>
+	void add(int sid, int x, int y, const P& px)
+	{
+		const vector_t v = get(x, y, px).template cast<double>();
+		count[sid] += 1.0;
+		sum[sid] += v;
+		sum_sq[sid] += v * v.transpose();
+	}
+
+	void merge(const MomentFeatures& other)
+	{
+		for(size_t i=0; i<count.size(); i++) {
+			count[i] += other.count[i];
+			sum[i] += other.sum[i];
+			sum_sq[i] += other.sum_sq[i];
+		}
+	}
+
+	/** Mean feature vector of a superpixel (zero for empty superpixels) */
+	Eigen::Matrix<float,N,1> mean(size_t sid) const
+	{
+		if(count[sid] == 0.0) {
+			return Eigen::Matrix<float,N,1>::Zero();
+		}
+		return (sum[sid] / count[sid]).template cast<float>();
+	}
+
+	/** Covariance of the feature vector of a superpixel (zero for empty superpixels) */
+	Eigen::Matrix<float,N,N> covariance(size_t sid) const
+	{
+		if(count[sid] == 0.0) {
+			return Eigen::Matrix<float,N,N>::Zero();
+		}
+		const vector_t m = sum[sid] / count[sid];
+		return (sum_sq[sid] / count[sid] - m * m.transpose()).template cast<float>();
+	}
+};
+
+template<int N, typename G>
+MomentFeatures<N,G> MakeMomentFeatures(G get)
+{ return MomentFeatures<N,G>(get); }
+
+/** Histogram of a per-pixel bin index for each superpixel
+ * G maps (x, y, pixel) to a bin index in [0,num_bins), pixels with other bin indices are ignored.
+ */
+template<typename G>
+struct HistogramFeatures
+{
+	G bin;
+	unsigned num_bins;
+	std::vector<unsigned> counts;
+
+	HistogramFeatures(unsigned num_bins, G bin)
+	:	bin(bin), num_bins(num_bins)
+	{}
+
+	void resize(size_t n)
+	{ counts.assign(n*num_bins, 0); }
+
+	template<typename P>
+	void add(int sid, int x, int y, const P& px)
+	{
+		const int b = bin(x, y, px);
+		if(0 <= b && b < static_cast<int>(num_bins)) {
+			counts[sid*num_bins + b]++;
+		}
+	}
+
+	void merge(const HistogramFeatures& other)
+	{
+		for(size_t i=0; i<counts.size(); i++) {
+			counts[i] += other.counts[i];
+		}
+	}
+
+	/** Histogram of a superpixel with num_bins entries */
+	const unsigned* histogram(size_t sid) const
+	{ return counts.data() + sid*num_bins; }
+};
+
+template<typename G>
+HistogramFeatures<G> MakeHistogramFeatures(unsigned num_bins, G bin)
+{ return HistogramFeatures<G>(num_bins, bin); }
+
+}
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <asp/segmentation.hpp>
+#include <asp/execution.hpp>
 #include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/copy.hpp>
 #include <iostream>
+#include <map>
+#include <algorithm>
+#include <vector>
+#include <cassert>
 
 namespace asp
 {
@@ -57,32 +61,51 @@ namespace asp
 		bool operator<(const edge_t& u, const edge_t& v)
 		{ return u.a < v.a || (u.a == v.a && u.b < v.b); }
 
+		/** Finds border pixels between neighbouring segments
+		 * Borders are keyed by (segment of the pixel, segment of its right or lower neighbour),
+		 * thus a pair of segments can have two entries (a,b) and (b,a).
+		 * Horizontal bands are processed in parallel and merged in band order.
+		 */
 		inline
-		std::map<edge_t,std::vector<size_t>> FindBorders(const slimage::Image<int,1>& indices)
+		std::map<edge_t,std::vector<size_t>> FindBorders(const slimage::Image<int,1>& indices, const ExecutionContext& exec=ExecutionContext::Serial())
 		{
-			std::map<edge_t,std::vector<size_t>> result;
 			const int width = indices.width();
 			const int height = indices.height();
-			size_t k = 0;
-			for(int y=0; y<height-1; y++) {
-				for(int x=0; x<width-1; x++, k++) {
-					int i0 = indices(x,y);
-					if(i0 == -1) {
-						continue;
-					}
-					int i1 = indices(x+1,y);
-					int i2 = indices(x,y+1);
-					if(i0 != i1 && i1 != -1) {
-						auto& r = result[{i0,i1}];
-						r.push_back(k);
-						r.push_back(k+1);
-					}
-					if(i0 != i2 && i2 != -1) {
-						auto& r = result[{i0,i2}];
-						r.push_back(k);
-						r.push_back(k+width);
+			const int num_rows = std::max(height - 1, 0);
+			const size_t num_bands = exec.numChunks(num_rows);
+			std::vector<std::map<edge_t,std::vector<size_t>>> band_result(num_bands);
+			exec.parallel_for(num_bands, [&](size_t band) {
+				auto& result = band_result[band];
+				const int y1 = ChunkBegin(num_rows, num_bands, band);
+				const int y2 = ChunkBegin(num_rows, num_bands, band + 1);
+				for(int y=y1; y<y2; y++) {
+					for(int x=0; x<width-1; x++) {
+						const size_t k = static_cast<size_t>(y)*width + x;
+						int i0 = indices(x,y);
+						if(i0 == -1) {
+							continue;
+						}
+						int i1 = indices(x+1,y);
+						int i2 = indices(x,y+1);
+						if(i0 != i1 && i1 != -1) {
+							auto& r = result[{i0,i1}];
+							r.push_back(k);
+							r.push_back(k+1);
+						}
+						if(i0 != i2 && i2 != -1) {
+							auto& r = result[{i0,i2}];
+							r.push_back(k);
+							r.push_back(k+width);
+						}
 					}
 				}
+			});
+			std::map<edge_t,std::vector<size_t>> result = std::move(band_result.front());
+			for(size_t band=1; band<num_bands; band++) {
+				for(const auto& q : band_result[band]) {
+					auto& r = result[q.first];
+					r.insert(r.end(), q.second.begin(), q.second.end());
+				}
 			}
 			return result;
 		}
@@ -90,7 +113,7 @@ namespace asp
 
 	/** Creates a segment neighbourhood graph from a segmentation */
 	template<typename T>
-	SegmentBorderGraph<T> CreateSegmentBorderGraph(const Segmentation<T>& seg)
+	SegmentBorderGraph<T> CreateSegmentBorderGraph(const Segmentation<T>& seg, const ExecutionContext& exec=ExecutionContext::Serial())
 	{
 		using graph_t = SegmentBorderGraph<T>;
 		// create superpixel graph (one node per superpixel)
@@ -99,7 +122,7 @@ namespace asp
 			ng[vid] = seg.superpixels[vid]; // TODO correctly convert vertex descriptor to superpixel id
 		}
 		// find borders
-		auto borders = detail::FindBorders(seg.indices);
+		auto borders = detail::FindBorders(seg.indices, exec);
 		// create edges
 		for(const auto& q : borders) {
 			auto r = boost::add_edge(q.first.a, q.first.b, ng); // TODO correctly convert superpixel id to vertex descriptor
@@ -109,26 +132,111 @@ namespace asp
 		return ng;
 	}
 
-	/** Creates a weighted segment neighbourhood graph */
+	/** Creates a weighted segment neighbourhood graph
+	 * Edge weights are computed with dist(a, b, border_pixels) in parallel over the list of edges.
+	 */
 	template<typename T, typename F>
-	SegmentGraph<T> CreateSegmentGraph(const SegmentBorderGraph<T>& border_graph, F dist)
+	SegmentGraph<T> CreateSegmentGraph(const SegmentBorderGraph<T>& border_graph, F dist, const ExecutionContext& exec=ExecutionContext::Serial())
 	{
 		using input_graph_t = SegmentBorderGraph<T>;
 		using result_graph_t = SegmentGraph<T>;
-		result_graph_t result;
-		boost::copy_graph(border_graph, result,
-			boost::vertex_copy(
-				[&border_graph,&result,&dist](typename input_graph_t::vertex_descriptor src, typename result_graph_t::vertex_descriptor dst) {
-					result[dst] = border_graph[src];
-				}
-			)
-			.edge_copy(
-				[&border_graph,&result,&dist](typename input_graph_t::edge_descriptor src, typename result_graph_t::edge_descriptor dst) {
-					result[dst] = dist(border_graph[boost::source(src,border_graph)], border_graph[boost::target(src,border_graph)], border_graph[src]);
-				}
-			)
-		);
+		const size_t num_vertices = boost::num_vertices(border_graph);
+		result_graph_t result(num_vertices);
+		for(size_t vid=0; vid<num_vertices; vid++) {
+			result[vid] = border_graph[vid];
+		}
+		// copy edges (graph structure can not be modified in parallel)
+		std::vector<std::pair<typename input_graph_t::edge_descriptor, typename result_graph_t::edge_descriptor>> edges;
+		edges.reserve(boost::num_edges(border_graph));
+		for(const auto& eid : detail::as_range(boost::edges(border_graph))) {
+			auto r = boost::add_edge(boost::source(eid, border_graph), boost::target(eid, border_graph), result);
+			edges.push_back(std::make_pair(eid, r.first));
+		}
+		// compute edge weights
+		const size_t num_chunks = exec.numChunks(edges.size());
+		exec.parallel_for(num_chunks, [&](size_t chunk) {
+			const size_t i1 = detail::ChunkBegin(edges.size(), num_chunks, chunk);
+			const size_t i2 = detail::ChunkBegin(edges.size(), num_chunks, chunk + 1);
+			for(size_t i=i1; i<i2; i++) {
+				const auto& src = edges[i].first;
+				result[edges[i].second] = dist(border_graph[boost::source(src,border_graph)], border_graph[boost::target(src,border_graph)], border_graph[src]);
+			}
+		});
 		return result;
 	}
 
-}
\ No newline at end of file
+	/** Edge weights of a segment neighbourhood graph which are computed on first use and memoized
+	 * For consumers which only look at a few edges (e.g. local merging) only these edges are evaluated.
+	 * Weights are identical to the ones of CreateSegmentGraph for the same edge.
+	 * The border graph must outlive this object.
+	 * Not thread-safe: weight() fills the cache, thus concurrent calls (also for different edges)
+	 * must be synchronized by the caller or each thread must use its own object.
+	 */
+	template<typename T, typename F>
+	class LazySegmentGraphWeights
+	{
+	public:
+		using edge_descriptor = typename SegmentBorderGraph<T>::edge_descriptor;
+
+		LazySegmentGraphWeights(const SegmentBorderGraph<T>& border_graph, F dist)
+		:	graph_(border_graph), dist_(dist), num_computed_(0)
+		{
+			for(const auto& eid : detail::as_range(boost::edges(graph_))) {
+				const int a = boost::source(eid, graph_);
+				const int b = boost::target(eid, graph_);
+				edges_.insert(std::make_pair(detail::edge_t{a,b}, eid));
+			}
+		}
+
+		/** True if there is an edge (a,b) or (b,a) */
+		bool hasEdge(int a, int b) const
+		{ return find(a, b) != edges_.end(); }
+
+		/** Weight of the edge between the neighbouring superpixels a and b
+		 * If the border graph has both edges (a,b) and (b,a), the one with this orientation is used.
+		 */
+		float weight(int a, int b)
+		{
+			auto it = find(a, b);
+			assert(it != edges_.end());
+			return weight(it->second);
+		}
+
+		/** Weight of an edge of the border graph */
+		float weight(const edge_descriptor& eid)
+		{
+			auto it = weights_.find(eid);
+			if(it != weights_.end()) {
+				return it->second;
+			}
+			const float w = dist_(graph_[boost::source(eid,graph_)], graph_[boost::target(eid,graph_)], graph_[eid]);
+			weights_.insert(std::make_pair(eid, w));
+			num_computed_++;
+			return w;
+		}
+
+		/** Number of edges for which the weight has been computed */
+		size_t numComputed() const
+		{ return num_computed_; }
+
+	private:
+		using edge_map_t = std::map<detail::edge_t,edge_descriptor>;
+
+		typename edge_map_t::const_iterator find(int a, int b) const
+		{
+			auto it = edges_.find(detail::edge_t{a,b});
+			return (it != edges_.end()) ? it : edges_.find(detail::edge_t{b,a});
+		}
+
+		const SegmentBorderGraph<T>& graph_;
+		F dist_;
+		edge_map_t edges_;
+		std::map<edge_descriptor,float> weights_;
+		size_t num_computed_;
+	};
+
+	template<typename T, typename F>
+	LazySegmentGraphWeights<T,F> MakeLazySegmentGraphWeights(const SegmentBorderGraph<T>& border_graph, F dist)
+	{ return LazySegmentGraphWeights<T,F>(border_graph, dist); }
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <asp/alic.hpp>
+#include <asp/pds.hpp>
+#include <asp/segmentation.hpp>
+#include <asp/execution.hpp>
+#include <slimage/image.hpp>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+namespace asp {
+
+/** Superpixel segmentations of the same image at several scales */
+template<typename T>
+struct SegmentationHierarchy
+{
+	// segmentations ordered from fine (many superpixels) to coarse (few superpixels)
+	// (all levels share the same input pixels, see ComputeHierarchy)
+	std::vector<Segmentation<T>> levels;
+
+	// parents[l][i] is the superpixel of level l+1 which covers most pixels of superpixel i of level l (-1 if none)
+	std::vector<std::vector<int>> parents;
+};
+
+namespace detail
+{
+	/** For each fine superpixel finds the coarse superpixel with the largest overlap
+	 * Overlaps are counted per band in parallel and merged in band order, ties go to the
+	 * coarse superpixel which comes first in row-major pixel order.
+	 */
+	inline
+	std::vector<int> ComputeParents(const slimage::Image<int,1>& fine, const slimage::Image<int,1>& coarse, size_t num_fine,
+		const ExecutionContext& exec=ExecutionContext::Serial())
+	{
+		// overlap counts per band and fine superpixel (only a few coarse superpixels overlap each fine superpixel)
+		using Overlap = std::vector<std::pair<int,unsigned>>;
+		auto add = [](Overlap& v, int c, unsigned n) {
+			auto it = std::find_if(v.begin(), v.end(),
+				[c](const std::pair<int,unsigned>& q) { return q.first == c; });
+			if(it == v.end()) {
+				v.push_back(std::make_pair(c, n));
+			}
+			else {
+				it->second += n;
+			}
+		};
+		const unsigned height = fine.height();
+		const size_t row = fine.width();
+		const size_t num_bands = exec.numChunks(height);
+		std::vector<std::vector<Overlap>> band_overlap(num_bands);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const size_t i1 = ChunkBegin(height, num_bands, band) * row;
+			const size_t i2 = ChunkBegin(height, num_bands, band + 1) * row;
+			auto& overlap = band_overlap[band];
+			overlap.resize(num_fine);
+			for(size_t i=i1; i<i2; i++) {
+				const int f = fine[i];
+				const int c = coarse[i];
+				if(f >= 0 && c >= 0) {
+					add(overlap[f], c, 1u);
+				}
+			}
+		});
+		std::vector<int> parents(num_fine, -1);
+		const size_t num_chunks = exec.numChunks(num_fine);
+		exec.parallel_for(num_chunks, [&](size_t chunk) {
+			Overlap overlap;
+			for(size_t f=ChunkBegin(num_fine, num_chunks, chunk); f<ChunkBegin(num_fine, num_chunks, chunk + 1); f++) {
+				overlap.clear();
+				for(const auto& bo : band_overlap) {
+					for(const auto& q : bo[f]) {
+						add(overlap, q.first, q.second);
+					}
+				}
+				unsigned best = 0;
+				for(const auto& q : overlap) {
+					if(q.second > best) {
+						best = q.second;
+						parents[f] = q.first;
+					}
+				}
+			}
+		});
+		return parents;
+	}
+}
+
+/** Computes superpixels for several superpixel counts from the same pixel data
+ * Pixel features are computed only once by the caller and all levels share the input pixels.
+ * For each scale the pixel density is scaled by Segmentation::density_scale to the desired superpixel count,
+ * seeds are sampled and ALIC is run. The shared input keeps the unscaled densities, thus levels
+ * can not be passed to incremental updates (see ALICUpdate).
+ * Levels are linked by the superpixel of the next coarser level which has the largest overlap.
+ */
+template<typename T, typename F>
+SegmentationHierarchy<T> ComputeHierarchy(const slimage::Image<Pixel<T>,1>& input, std::vector<unsigned> counts,
+	PoissonDiskSamplingMethod method, F dist,
+	const AlicParameters& opt=AlicParameters(), const ExecutionContext& exec=ExecutionContext::Serial())
+{
+	std::sort(counts.begin(), counts.end(), std::greater<unsigned>());
+	const size_t num_chunks = exec.numChunks(input.size());
+	std::vector<double> chunk_density(num_chunks, 0.0);
+	exec.parallel_for(num_chunks, [&](size_t chunk) {
+		const size_t i1 = detail::ChunkBegin(input.size(), num_chunks, chunk);
+		const size_t i2 = detail::ChunkBegin(input.size(), num_chunks, chunk + 1);
+		for(size_t i=i1; i<i2; i++) {
+			chunk_density[chunk] += input[i].density;
+		}
+	});
+	double total_density = 0.0;
+	for(double d : chunk_density) {
+		total_density += d;
+	}
+	SegmentationHierarchy<T> result;
+	for(unsigned count : counts) {
+		// scale density to the desired number of superpixels
+		const float scale = (total_density > 0.0) ? static_cast<float>(static_cast<double>(count) / total_density) : 0.0f;
+		result.levels.push_back(ALIC(input, ComputeSeeds(method, input, exec, 0, scale), dist, opt, exec, NoFeatures(), scale));
+		result.levels.back().density_scale = scale;
+	}
+	for(size_t l=0; l+1<result.levels.size(); l++) {
+		result.parents.push_back(detail::ComputeParents(
+			result.levels[l].indices, result.levels[l+1].indices, result.levels[l].superpixels.size(), exec));
+	}
+	return result;
+}
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+// Hot kernels are compiled for several x86 instruction sets and one is selected at runtime.
+// Define ASP_NO_ISA_DISPATCH to compile only the baseline version.
+// Only code which the compiler inlines into an ASP_KERNEL lambda is compiled for the wider instruction set:
+// the pixel loops of AlicAssign, AlicAccumulate and AlicRefineBoundaries (alic.hpp) and of the DASP pixel
+// computation (DASP.cpp). Distance functors, Eigen calls and other helpers which are not inlined, as well
+// as all remaining code, run the baseline version.
+// Variants give bitwise identical results as long as floating point contraction (e.g. into FMA) is disabled
+// for the kernels. With GCC the dispatch wrappers (including the baseline one) disable it for everything
+// which is inlined into them, thus this holds in every translation unit which instantiates the kernels.
+// Clang has no per-function setting, there translation units which instantiate the kernels need
+// -ffp-contract=off (set for the library sources, see src/libasp/CMakeLists.txt).
+#if !defined(ASP_NO_ISA_DISPATCH) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define ASP_ISA_DISPATCH 1
+	#define ASP_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+	#define ASP_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2")))
+	#define ASP_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512bw,avx512dq,avx2,bmi,bmi2")))
+	// kernels must be inlined into the dispatch wrappers to be compiled for their instruction set
+	#define ASP_KERNEL __attribute__((always_inline))
+	#if defined(__clang__)
+		#define ASP_NO_FP_CONTRACT
+	#else
+		#define ASP_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+	#endif
+#else
+	#define ASP_ISA_DISPATCH 0
+	#define ASP_KERNEL
+#endif
+
+namespace asp
+{
+
+	/** Instruction set variants of the hot kernels */
+	enum class Isa
+	{
+		Baseline,
+		Sse42,
+		Avx2,
+		Avx512
+	};
+
+	/** Name as used by the ASP_ISA environment variable (baseline, sse4.2, avx2, avx512) */
+	const char* IsaName(Isa isa);
+
+	/** Best instruction set supported by the CPU and the operating system (CPUID) */
+	Isa DetectIsa();
+
+	/** Instruction set used by the kernels
+	 * Defaults to DetectIsa() unless the environment variable ASP_ISA selects a lower one.
+	 */
+	Isa ActiveIsa();
+
+	/** Overrides the instruction set used by the kernels (e.g. for testing)
+	 * Instruction sets which are not supported by the CPU are reduced to the best supported one.
+	 * Returns the instruction set which is used.
+	 */
+	Isa SetActiveIsa(Isa isa);
+
+	namespace detail
+	{
+#if ASP_ISA_DISPATCH
+		template<typename F>
+		ASP_NO_FP_CONTRACT void RunBaseline(const F& f)
+		{ f(); }
+
+		template<typename F>
+		ASP_TARGET_SSE42 ASP_NO_FP_CONTRACT void RunSse42(const F& f)
+		{ f(); }
+
+		template<typename F>
+		ASP_TARGET_AVX2 ASP_NO_FP_CONTRACT void RunAvx2(const F& f)
+		{ f(); }
+
+		template<typename F>
+		ASP_TARGET_AVX512 ASP_NO_FP_CONTRACT void RunAvx512(const F& f)
+		{ f(); }
+#endif
+
+		/** Calls the kernel f() compiled for the active instruction set
+		 * f must be a lambda marked with ASP_KERNEL (after the parameter list).
+		 * Functions which are not inlined into f run the baseline version.
+		 */
+		template<typename F>
+		void IsaDispatch(const F& f)
+		{
+#if ASP_ISA_DISPATCH
+			switch(ActiveIsa()) {
+			case Isa::Avx512: RunAvx512(f); return;
+			case Isa::Avx2: RunAvx2(f); return;
+			case Isa::Sse42: RunSse42(f); return;
+			default: RunBaseline(f); return;
+			}
+#else
+			f();
+#endif
+		}
+	}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <asp/execution.hpp>
+#include <slimage/image.hpp>
+#include <vector>
+
+namespace asp
+{
+
+	/** Rectangular region of interest covering the pixels [x,x+width) x [y,y+height) */
+	struct Roi
+	{
+		unsigned x, y;
+		unsigned width, height;
+
+		bool empty() const
+		{ return width == 0 || height == 0; }
+	};
+
+	/** Binary mask (1 inside, 0 outside) for the union of the regions of interest (clipped to the image) */
+	slimage::Image1ub RoiMask(unsigned width, unsigned height, const std::vector<Roi>& rois);
+
+	/** Smallest rectangle which contains all non-zero mask pixels (empty if there are none) */
+	Roi MaskBoundingBox(const slimage::Image1ub& mask, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Clips the regions of interest to the image and merges overlapping ones into their bounding box
+	 * The resulting rectangles are not empty, do not overlap and are sorted by y and x.
+	 */
+	std::vector<Roi> MergeRois(unsigned width, unsigned height, const std::vector<Roi>& rois);
+
+	/** Bounding boxes of the connected components (4-neighbourhood) of the non-zero mask pixels
+	 * Overlapping boxes are merged (see MergeRois), thus each mask pixel is in exactly one box.
+	 */
+	std::vector<Roi> MaskRegions(const slimage::Image1ub& mask, const ExecutionContext& exec=ExecutionContext::Serial());
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <asp/execution.hpp>
+#include <slimage/image.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace asp
+{
+
+	/** Which inverse index from superpixels to their pixels is built */
+	enum class MembershipIndex
+	{
+		None,
+		Pixels, // pixel indices
+		Runs    // row runs
+	};
+
+	/** Horizontal run of pixels [x1,x2) in row y */
+	struct PixelRun
+	{
+		unsigned y;
+		unsigned x1, x2;
+	};
+
+	/** Pixels of each superpixel in compressed sparse row layout
+	 * Pixels and runs of a superpixel are stored in row-major order.
+	 */
+	struct SuperpixelMembership
+	{
+		// pixels of superpixel i are pixels[offsets[i]] to pixels[offsets[i+1]-1] (index y*width + x)
+		std::vector<unsigned> offsets;
+		std::vector<unsigned> pixels;
+
+		// runs of superpixel i are runs[run_offsets[i]] to runs[run_offsets[i+1]-1]
+		std::vector<unsigned> run_offsets;
+		std::vector<PixelRun> runs;
+
+		bool hasPixels() const
+		{ return !offsets.empty(); }
+
+		bool hasRuns() const
+		{ return !run_offsets.empty(); }
+
+		size_t numPixels(size_t i) const
+		{ return offsets[i + 1] - offsets[i]; }
+
+		size_t numRuns(size_t i) const
+		{ return run_offsets[i + 1] - run_offsets[i]; }
+	};
+
+	/** Builds the inverse index of a label image with a two pass counting sort over image bands
+	 * Labels must be smaller than num_superpixels, pixels with negative labels are skipped.
+	 */
+	SuperpixelMembership ComputeMembership(const slimage::Image<int,1>& indices, size_t num_superpixels,
+		MembershipIndex mode, const ExecutionContext& exec=ExecutionContext::Serial());
+
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <asp/segmentation.hpp>
+#include <asp/graph.hpp>
+#include <asp/alic.hpp>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <utility>
+
+namespace asp
+{
+
+	/** Merge of two regions into a new region */
+	struct MergeStep
+	{
+		// merged regions
+		int a, b;
+
+		// id of the new region
+		int merged;
+
+		// edge weight between a and b at the time of merging
+		float weight;
+	};
+
+	/** Binary merge tree over superpixels
+	 * Leaves have the ids 0,...,num_leaves-1 of the superpixels.
+	 * The region created by the i-th merge step has id num_leaves + i.
+	 */
+	struct MergeTree
+	{
+		size_t num_leaves = 0;
+
+		// merge steps in the order in which they were applied
+		std::vector<MergeStep> steps;
+	};
+
+	namespace detail
+	{
+		/** Union-find over region ids where the representative is the newest region */
+		struct MergeForest
+		{
+			std::vector<int> parent;
+
+			explicit MergeForest(size_t n)
+			: parent(n)
+			{
+				for(size_t i=0; i<n; i++) {
+					parent[i] = i;
+				}
+			}
+
+			int find(int i)
+			{
+				int root = i;
+				while(parent[root] != root) {
+					root = parent[root];
+				}
+				// path compression
+				while(parent[i] != root) {
+					int next = parent[i];
+					parent[i] = root;
+					i = next;
+				}
+				return root;
+			}
+
+			bool isRoot(int i) const
+			{ return parent[i] == i; }
+		};
+
+		/** Binary min-heap of edge ids with erase by id
+		 * Edges with equal weight are ordered by id, thus the order is deterministic.
+		 */
+		class EdgeHeap
+		{
+		public:
+			bool empty() const
+			{ return heap_.empty(); }
+
+			int top() const
+			{ return heap_.front(); }
+
+			float weight(int e) const
+			{ return weight_[e]; }
+
+			void push(int e, float w)
+			{
+				if(static_cast<size_t>(e) >= pos_.size()) {
+					pos_.resize(e + 1, -1);
+					weight_.resize(e + 1, 0.0f);
+				}
+				weight_[e] = w;
+				pos_[e] = heap_.size();
+				heap_.push_back(e);
+				up(pos_[e]);
+			}
+
+			/** Removes the edge if it is in the heap */
+			void erase(int e)
+			{
+				if(static_cast<size_t>(e) >= pos_.size() || pos_[e] < 0) {
+					return;
+				}
+				const int i = pos_[e];
+				pos_[e] = -1;
+				const int last = heap_.back();
+				heap_.pop_back();
+				if(last == e) {
+					return;
+				}
+				heap_[i] = last;
+				pos_[last] = i;
+				up(i);
+				down(pos_[last]);
+			}
+
+		private:
+			bool less(int u, int v) const
+			{ return weight_[u] < weight_[v] || (weight_[u] == weight_[v] && u < v); }
+
+			void swap(int i, int j)
+			{
+				std::swap(heap_[i], heap_[j]);
+				pos_[heap_[i]] = i;
+				pos_[heap_[j]] = j;
+			}
+
+			void up(int i)
+			{
+				while(i > 0 && less(heap_[i], heap_[(i - 1)/2])) {
+					swap(i, (i - 1)/2);
+					i = (i - 1)/2;
+				}
+			}
+
+			void down(int i)
+			{
+				const int n = heap_.size();
+				while(true) {
+					int best = i;
+					for(int c=2*i + 1; c<=2*i + 2 && c<n; c++) {
+						if(less(heap_[c], heap_[best])) {
+							best = c;
+						}
+					}
+					if(best == i) {
+						return;
+					}
+					swap(i, best);
+					i = best;
+				}
+			}
+
+			std::vector<int> heap_;
+			std::vector<int> pos_; // position of each edge in heap_ or -1
+			std::vector<float> weight_;
+		};
+	}
+
+	/** Computes a merge tree by greedy region merging with mean linkage
+	 * Always the adjacent pair of regions with the smallest edge weight is merged.
+	 * Initial priorities are the edge weights of the graph. After a merge the edges of the
+	 * two regions are removed from the queue and the merged region gets one edge to each
+	 * neighbour with weight dist(a,b) of the region means. Region means are averages over
+	 * the superpixels in the region weighted with their number of pixels (SegmentBase::num),
+	 * thus dist should be consistent with the weights of the graph.
+	 * Runs in O((E + D) log E) where D is the sum of the degrees of all merged regions.
+	 */
+	template<typename T, typename F>
+	MergeTree ComputeMergeTree(const SegmentGraph<T>& graph, F dist)
+	{
+		const size_t n = boost::num_vertices(graph);
+		MergeTree tree;
+		tree.num_leaves = n;
+		if(n == 0) {
+			return tree;
+		}
+		// region sums, each superpixel is weighted with its number of pixels
+		std::vector<detail::SegmentAccumulator<T>> regions(2*n - 1);
+		for(size_t i=0; i<n; i++) {
+			SegmentBase<T> sp = graph[i];
+			if(sp.num > 0.0f) {
+				// data is accumulated without weight, so scale it here
+				sp.data.normalize(1.0f / sp.num);
+				regions[i].add(sp);
+			}
+		}
+		// edges between regions: end points, alive flag and edges per region
+		std::vector<std::pair<int,int>> edges;
+		std::vector<bool> alive;
+		std::vector<std::vector<int>> adjacent(2*n - 1);
+		detail::EdgeHeap queue;
+		auto add_edge = [&](int a, int b, float weight) {
+			const int e = edges.size();
+			edges.push_back(std::make_pair(a, b));
+			alive.push_back(true);
+			adjacent[a].push_back(e);
+			adjacent[b].push_back(e);
+			queue.push(e, weight);
+		};
+		for(const auto& eid : detail::as_range(boost::edges(graph))) {
+			add_edge(boost::source(eid, graph), boost::target(eid, graph), graph[eid]);
+		}
+		// mark[c] == m if region c was already collected as neighbour of region m
+		std::vector<int> mark(2*n - 1, -1);
+		std::vector<int> neighbours;
+		while(!queue.empty()) {
+			const int e = queue.top();
+			const float weight = queue.weight(e);
+			const int a = edges[e].first;
+			const int b = edges[e].second;
+			const int m = n + tree.steps.size();
+			regions[m] = regions[a];
+			regions[m].merge(regions[b]);
+			tree.steps.push_back({a, b, m, weight});
+			// remove all edges of a and b and collect their other neighbours
+			neighbours.clear();
+			for(int r : {a, b}) {
+				for(int f : adjacent[r]) {
+					if(!alive[f]) {
+						continue;
+					}
+					alive[f] = false;
+					queue.erase(f);
+					const int c = (edges[f].first == r) ? edges[f].second : edges[f].first;
+					if(c != a && c != b && mark[c] != m) {
+						mark[c] = m;
+						neighbours.push_back(c);
+					}
+				}
+				std::vector<int>().swap(adjacent[r]);
+			}
+			// connect the merged region to the neighbours
+			const auto mean_m = regions[m].mean();
+			for(int c : neighbours) {
+				auto& adj = adjacent[c];
+				adj.erase(std::remove_if(adj.begin(), adj.end(), [&alive](int f) { return !alive[f]; }), adj.end());
+				add_edge(m, c, dist(mean_m, regions[c].mean()));
+			}
+		}
+		return tree;
+	}
+
+	/** Labels superpixels with the regions obtained when merging stops at num_segments regions
+	 * Returns a region label in [0,num_segments) for each superpixel. If the superpixel graph
+	 * has more connected components than num_segments, one region per component is returned.
+	 * Runs in O(V).
+	 */
+	inline
+	std::vector<int> CutMergeTree(const MergeTree& tree, size_t num_segments)
+	{
+		const size_t n = tree.num_leaves;
+		const size_t num_merges = std::min(tree.steps.size(), (n > num_segments) ? n - num_segments : 0);
+		detail::MergeForest forest(n + num_merges);
+		for(size_t i=0; i<num_merges; i++) {
+			const MergeStep& step = tree.steps[i];
+			forest.parent[step.a] = step.merged;
+			forest.parent[step.b] = step.merged;
+		}
+		std::vector<int> labels(n);
+		std::vector<int> region_label(n + num_merges, -1);
+		int num_labels = 0;
+		for(size_t i=0; i<n; i++) {
+			const int r = forest.find(i);
+			if(region_label[r] == -1) {
+				region_label[r] = num_labels++;
+			}
+			labels[i] = region_label[r];
+		}
+		return labels;
+	}
+
+}
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <asp/segmentation.hpp>
+#include <asp/execution.hpp>
+#include <asp/density.hpp>
 #include <Eigen/Dense>
+#include <memory>
 #include <vector>
+#include <cstdint>
 
 namespace asp {
 
@@ -11,11 +15,59 @@ enum class PoissonDiskSamplingMethod
 	Random,
 	Grid,
 	FloydSteinberg,
-	FloydSteinbergExpo
+	FloydSteinbergExpo,
+	RandomCounter
 };
 
+/** Poisson disk sampling of a density function indexed as density(x,y) (does not build a summed area table) */
 std::vector<Eigen::Vector2f> PoissonDiskSampling(PoissonDiskSamplingMethod method, const Eigen::MatrixXf& density);
 
+/** Poisson disk sampling which uses a precomputed summed area table of the density
+ * Methods which support it are run in parallel with the given execution context.
+ * random_seed is the key for PoissonDiskSamplingMethod::RandomCounter (see PdsRandomCounter).
+ */
+std::vector<Eigen::Vector2f> PoissonDiskSampling(PoissonDiskSamplingMethod method, const Eigen::MatrixXf& density, const DensityIntegral& integral,
+	const ExecutionContext& exec=ExecutionContext::Serial(), uint64_t random_seed=0);
+
+/** Random sampling where each pixel gets a seed with probability equal to its density
+ * Random numbers come from a counter-based generator keyed by 'seed' and the pixel index,
+ * thus results are reproducible and do not depend on the number of threads.
+ * Seeds are placed at a random sub-pixel position inside their pixel.
+ * PoissonDiskSamplingMethod::RandomCounter uses the random seed given to PoissonDiskSampling or ComputeSeeds (0 by default).
+ */
+std::vector<Eigen::Vector2f> PdsRandomCounter(const Eigen::MatrixXf& density, uint64_t seed, const ExecutionContext& exec=ExecutionContext::Serial());
+
+/** Poisson disk sampling for a density which is given in blocks of rows from top to bottom
+ * Gives the same samples in the same order as PoissonDiskSampling for the whole density,
+ * but only keeps the state of a few rows (e.g. for images which are processed in strips).
+ * Grid sampling depends on the total density and returns all samples with the last row.
+ */
+class PoissonDiskSampler
+{
+public:
+	/** random_seed is the key for PoissonDiskSamplingMethod::RandomCounter (see PdsRandomCounter) */
+	PoissonDiskSampler(PoissonDiskSamplingMethod method, unsigned width, unsigned height,
+		const ExecutionContext& exec=ExecutionContext::Serial(), uint64_t random_seed=0);
+
+	~PoissonDiskSampler();
+
+	PoissonDiskSampler(const PoissonDiskSampler&) = delete;
+	PoissonDiskSampler& operator=(const PoissonDiskSampler&) = delete;
+
+	/** Samples the next density.cols() rows, i.e. density(x,y) is the density of pixel (x, rows() + y)
+	 * Returns the samples which are complete (in image coordinates).
+	 * Throws std::runtime_error if the block does not fit into the image.
+	 */
+	std::vector<Eigen::Vector2f> add(const Eigen::MatrixXf& density);
+
+	/** Number of rows which were added so far */
+	unsigned rows() const;
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> impl_;
+};
+
 /** Superpixel seed */
 struct Seed
 {
@@ -23,25 +75,39 @@ struct Seed
 	float density;
 };
 
-/** Compute seeds accordingly to pixel density values */
+/** Compute seeds accordingly to pixel density values
+ * Seed density is the mean density of the valid pixels in the footprint of the seed.
+ * random_seed selects the sample set of randomized methods (see PoissonDiskSampling).
+ * Pixel densities are multiplied with density_scale.
+ */
 template<typename T>
-std::vector<Seed> ComputeSeeds(PoissonDiskSamplingMethod method, const slimage::Image<Pixel<T>,1>& input)
+std::vector<Seed> ComputeSeeds(PoissonDiskSamplingMethod method, const slimage::Image<Pixel<T>,1>& input, const ExecutionContext& exec=ExecutionContext::Serial(),
+	uint64_t random_seed=0, float density_scale=1.0f)
 {
 	const unsigned width = input.width();
 	const unsigned height = input.height();
 	Eigen::MatrixXf density{width, height};
-	for(unsigned y=0; y<height; y++) {
-		for(unsigned x=0; x<width; x++) {
-			density(x,y) = ((Pixel<T>&)input(x,y)).density;
+	DensityIntegral::ValidMask valid{width, height};
+	const size_t num_bands = exec.numChunks(height);
+	exec.parallel_for(num_bands, [&](size_t band) {
+		const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+		const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+		for(unsigned y=y1; y<y2; y++) {
+			for(unsigned x=0; x<width; x++) {
+				const Pixel<T>& px = input(x,y);
+				density(x,y) = px.density * density_scale;
+				valid(x,y) = px.valid();
+			}
 		}
-	}
-	std::vector<Eigen::Vector2f> pntseeds = PoissonDiskSampling(method, density);
+	});
+	const DensityIntegral integral(density, valid);
+	std::vector<Eigen::Vector2f> pntseeds = PoissonDiskSampling(method, density, integral, exec, random_seed);
 	std::vector<Seed> seeds(pntseeds.size());
 	for(unsigned i=0; i<pntseeds.size(); i++) {
 		auto& sp = seeds[i];
 		sp.position = pntseeds[i];
 		const Pixel<T>& inp_px = input(std::floor(sp.position.x()), std::floor(sp.position.y()));
-		sp.density = inp_px.density; // FIXME use bb?
+		sp.density = integral.footprintMean(sp.position, inp_px.density * density_scale);
 	}
 	return seeds;
 }
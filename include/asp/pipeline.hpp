@@ -0,0 +1,61 @@
+#pragma once
+
+#include <asp/algos.hpp>
+#include <asp/execution.hpp>
+#include <asp/sequence.hpp>
+#include <slimage/image.hpp>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace asp
+{
+
+	/** Asynchronous DASP processing for a stream of RGB-D frames
+	 * Frames pass through three stages which run concurrently in their own threads:
+	 *  1. preprocessing: pixel features, density and seeds
+	 *  2. clustering: ALIC
+	 *  3. post processing: an optional function of the caller, e.g. graph building or export
+	 * While frame N is clustered, frame N+1 is preprocessed and frame N-1 is post processed,
+	 * so throughput approaches the slowest stage instead of the sum of all stages.
+	 * Stages are connected by bounded queues, thus push blocks if the pipeline is full.
+	 * Frames leave the pipeline in the order in which they were pushed.
+	 * If a stage (or the post processing function) throws for a frame, the exception is
+	 * stored in the future of that frame and the pipeline continues with the next frame.
+	 */
+	class DaspPipeline
+	{
+	public:
+		/** Function which is called for each finished frame in the post processing stage */
+		using PostProcess = std::function<void(const Segmentation<PixelRgbd>&)>;
+
+		/** Starts the pipeline threads
+		 * queue_size is the maximal number of frames waiting in front of each stage.
+		 * exec is used for parallel loops inside each stage.
+		 */
+		DaspPipeline(const DaspParameters& opt=DaspParameters(), PostProcess post=PostProcess(),
+			unsigned queue_size=2, const ExecutionContext& exec=ExecutionContext::Serial());
+
+		/** Finishes all pending frames and stops the pipeline threads */
+		~DaspPipeline();
+
+		DaspPipeline(const DaspPipeline&) = delete;
+		DaspPipeline& operator=(const DaspPipeline&) = delete;
+
+		/** Adds a frame to the pipeline and returns a future for its superpixels
+		 * The future becomes ready after the post processing stage finished the frame.
+		 * Image data may be shared with the pipeline, so it must not be modified until the future is ready.
+		 */
+		std::future<Segmentation<PixelRgbd>> push(const slimage::Image3ub& color, const slimage::Image1ui16& depth);
+
+		/** Adds a frame view to the pipeline, e.g. a frame of a RawSequenceReader, without copying the pixel data
+		 * The viewed data must stay valid until the future is ready.
+		 */
+		std::future<Segmentation<PixelRgbd>> push(const RawFrameView& frame);
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> impl_;
+	};
+
+}
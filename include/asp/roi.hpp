@@ -0,0 +1,169 @@
+#pragma once
+
+#include <asp/alic.hpp>
+#include <asp/mask.hpp>
+#include <asp/pds.hpp>
+#include <asp/segmentation.hpp>
+#include <asp/execution.hpp>
+#include <slimage/image.hpp>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <chrono>
+
+namespace asp
+{
+
+	namespace detail
+	{
+		/** Throws std::runtime_error if the mask does not have the given size */
+		void CheckMaskSize(const slimage::Image1ub& mask, unsigned width, unsigned height);
+
+		/** Computes pixels for the mask pixels in the bounding box
+		 * f(x,y) is called with image coordinates for all mask pixels and must return the pixel.
+		 * Pixels outside of the mask are copies of 'outside'. Pixel positions are relative to the box.
+		 */
+		template<typename T, typename F>
+		slimage::Image<Pixel<T>,1> MaskedPixels(const slimage::Image1ub& mask, const Roi& box, const Pixel<T>& outside, F f, const ExecutionContext& exec)
+		{
+			slimage::Image<Pixel<T>,1> pixels{box.width, box.height};
+			const Eigen::Vector2f offset{ static_cast<float>(box.x), static_cast<float>(box.y) };
+			const size_t num_bands = exec.numChunks(box.height);
+			exec.parallel_for(num_bands, [&](size_t band) {
+				const unsigned y1 = detail::ChunkBegin(box.height, num_bands, band);
+				const unsigned y2 = detail::ChunkBegin(box.height, num_bands, band + 1);
+				for(unsigned y=y1; y<y2; y++) {
+					for(unsigned x=0; x<box.width; x++) {
+						Pixel<T>& q = pixels(x,y);
+						if(mask(box.x + x, box.y + y)) {
+							q = f(box.x + x, box.y + y);
+							q.position -= offset;
+						}
+						else {
+							q = outside;
+							q.position = { static_cast<float>(x), static_cast<float>(y) };
+						}
+					}
+				}
+			});
+			return pixels;
+		}
+
+		/** Pixels of one region of a mask (see MaskRegions) */
+		template<typename T>
+		struct MaskedRegion
+		{
+			Roi box;
+
+			// pixels of the box (see MaskedPixels)
+			slimage::Image<Pixel<T>,1> pixels;
+		};
+
+		/** Computes the pixels of all regions (see MaskedPixels) */
+		template<typename T, typename F>
+		std::vector<MaskedRegion<T>> MaskedRegionPixels(const slimage::Image1ub& mask, const std::vector<Roi>& boxes, const Pixel<T>& outside, F f, const ExecutionContext& exec)
+		{
+			std::vector<MaskedRegion<T>> regions;
+			regions.reserve(boxes.size());
+			for(const Roi& box : boxes) {
+				regions.push_back(MaskedRegion<T>{box, MaskedPixels(mask, box, outside, f, exec)});
+			}
+			return regions;
+		}
+
+		/** Adds the superpixels of a segmentation of a box to a segmentation in image coordinates
+		 * Labels of the box are shifted by the number of superpixels which are already in s.
+		 * The box must not overlap boxes which were added before. Only the box is visited.
+		 */
+		template<typename T>
+		void AddRegionSegmentation(Segmentation<T>& s, const Segmentation<T>& local, const Roi& box)
+		{
+			const unsigned width = s.indices.width();
+			const int label_offset = s.superpixels.size();
+			const Eigen::Vector2f offset{ static_cast<float>(box.x), static_cast<float>(box.y) };
+			for(unsigned y=0; y<box.height; y++) {
+				for(unsigned x=0; x<box.width; x++) {
+					const int label = local.indices(x,y);
+					if(label >= 0) {
+						s.indices(box.x + x, box.y + y) = label + label_offset;
+						s.weights(box.x + x, box.y + y) = local.weights(x,y);
+					}
+				}
+			}
+			for(const auto& sp : local.superpixels) {
+				s.superpixels.push_back(sp);
+				s.superpixels.back().position += offset;
+			}
+			// membership index in image coordinates (row-major order within superpixels is preserved)
+			SuperpixelMembership& m = s.membership;
+			const SuperpixelMembership& lm = local.membership;
+			if(lm.hasPixels()) {
+				const unsigned base = m.pixels.size();
+				for(size_t i=1; i<lm.offsets.size(); i++) {
+					m.offsets.push_back(base + lm.offsets[i]);
+				}
+				for(unsigned i : lm.pixels) {
+					m.pixels.push_back((box.y + i / box.width)*width + box.x + i % box.width);
+				}
+			}
+			if(lm.hasRuns()) {
+				const unsigned base = m.runs.size();
+				for(size_t i=1; i<lm.run_offsets.size(); i++) {
+					m.run_offsets.push_back(base + lm.run_offsets[i]);
+				}
+				for(PixelRun r : lm.runs) {
+					r.y += box.y;
+					r.x1 += box.x;
+					r.x2 += box.x;
+					m.runs.push_back(r);
+				}
+			}
+		}
+
+		/** Computes superpixels for each region separately and returns them in image coordinates
+		 * Labels and weights are images of size width x height, pixels outside of the regions are not
+		 * assigned to a superpixel. The input image of the result is empty as pixels were only computed
+		 * for the regions. Seeds which fall onto pixels outside of the mask (i.e. invalid pixels) are discarded.
+		 * A time budget applies to all regions together, each region gets the remaining time
+		 * (and at least one iteration).
+		 */
+		template<typename T, typename F>
+		Segmentation<T> MaskedAlic(const std::vector<MaskedRegion<T>>& regions, unsigned width, unsigned height,
+			PoissonDiskSamplingMethod method, F dist, const AlicParameters& opt, const ExecutionContext& exec)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			Segmentation<T> s;
+			s.indices = slimage::Image<int,1>{width, height};
+			std::fill(s.indices.begin(), s.indices.end(), -1);
+			s.weights = slimage::Image1f{width, height};
+			std::fill(s.weights.begin(), s.weights.end(), std::numeric_limits<float>::max());
+			s.iterations = regions.empty() ? 0 : opt.iterations;
+			if(opt.membership == MembershipIndex::Pixels) {
+				s.membership.offsets.push_back(0);
+			}
+			if(opt.membership == MembershipIndex::Runs) {
+				s.membership.run_offsets.push_back(0);
+			}
+			AlicParameters region_opt = opt;
+			for(const MaskedRegion<T>& region : regions) {
+				const auto& pixels = region.pixels;
+				std::vector<Seed> seeds = ComputeSeeds(method, pixels, exec);
+				seeds.erase(std::remove_if(seeds.begin(), seeds.end(),
+					[&pixels](const Seed& seed) {
+						return !pixels(std::floor(seed.position.x()), std::floor(seed.position.y())).valid();
+					}), seeds.end());
+				if(opt.time_budget_ms > 0.0f) {
+					const float elapsed_ms = std::chrono::duration<float,std::milli>(std::chrono::steady_clock::now() - start).count();
+					region_opt.time_budget_ms = std::max(opt.time_budget_ms - elapsed_ms, 1e-3f);
+				}
+				const Segmentation<T> local = ALIC(pixels, seeds, dist, region_opt, exec);
+				AddRegionSegmentation(s, local, region.box);
+				s.iterations = std::min(s.iterations, local.iterations);
+				s.deadline_exceeded = s.deadline_exceeded || local.deadline_exceeded;
+			}
+			return s;
+		}
+	}
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <asp/membership.hpp>
 #include <slimage/image.hpp>
 #include <Eigen/Dense>
 #include <vector>
@@ -36,6 +37,14 @@ struct SegmentBase
 		data.accumulate(v.data);
 	}
 
+	void deaccumulate(const SegmentBase& v)
+	{
+		num -= v.num;
+		position -= v.num * v.position;
+		density -= v.num * v.density;
+		data.deaccumulate(v.data);
+	}
+
 	void normalize(float weight)
 	{
 		num /= weight;
@@ -73,6 +82,20 @@ struct Segmentation
 
 	// pixel-superpixel distance for each pixel
 	slimage::Image<float,1> weights;
+
+	// number of completed clustering iterations
+	unsigned iterations = 0;
+
+	// true if the time budget of the clustering ended it before all iterations were completed
+	bool deadline_exceeded = false;
+
+	// factor which was applied to the pixel densities, e.g. to obtain a requested number of superpixels
+	// (1 if densities are unscaled, kept by incremental updates to scale recomputed pixels alike;
+	// levels of a SegmentationHierarchy keep unscaled pixels and only scale the superpixel densities)
+	float density_scale = 1.0f;
+
+	// pixels of each superpixel (only filled if requested, see AlicParameters::membership)
+	SuperpixelMembership membership;
 	
 };
 
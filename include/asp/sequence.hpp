@@ -0,0 +1,122 @@
+#pragma once
+
+#include <slimage/image.hpp>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace asp
+{
+
+	/** Raw RGB-D frame sequence file
+	 * Layout (native byte order):
+	 *   header: magic "ASPRGBD", version, width, height, number of frames (see RawSequenceHeader)
+	 *   frames: color (width*height RGB bytes) followed by depth (width*height uint16),
+	 *           both blocks padded to a multiple of 8 bytes, all frames have the same size
+	 * Frames can be accessed without decoding, which makes offline replays limited by compute.
+	 */
+	struct RawSequenceHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t num_frames;
+		uint32_t reserved[2];
+	};
+
+	/** Non-owning view of an RGB-D frame, e.g. of a mapped sequence (valid as long as the reader exists) or of NumPy arrays
+	 * Pixels are stored row by row without padding between rows.
+	 */
+	struct RawFrameView
+	{
+		unsigned width = 0;
+		unsigned height = 0;
+
+		// interleaved RGB bytes (3*width*height)
+		const unsigned char* color = nullptr;
+
+		// depth values (width*height)
+		const uint16_t* depth = nullptr;
+
+		/** RGB bytes of pixel (x,y) */
+		const unsigned char* colorAt(unsigned x, unsigned y) const
+		{ return color + 3*(static_cast<size_t>(y)*width + x); }
+
+		/** Depth value of pixel (x,y) */
+		uint16_t depthAt(unsigned x, unsigned y) const
+		{ return depth[static_cast<size_t>(y)*width + x]; }
+	};
+
+	/** Reads a raw RGB-D sequence by mapping the file into memory
+	 * Throws std::runtime_error if the file can not be opened or is not a valid sequence.
+	 */
+	class RawSequenceReader
+	{
+	public:
+		explicit RawSequenceReader(const std::string& filename);
+
+		~RawSequenceReader();
+
+		RawSequenceReader(const RawSequenceReader&) = delete;
+		RawSequenceReader& operator=(const RawSequenceReader&) = delete;
+
+		unsigned width() const;
+
+		unsigned height() const;
+
+		size_t numFrames() const;
+
+		/** Interleaved RGB bytes of frame i (points into the mapped file) */
+		const unsigned char* colorData(size_t i) const;
+
+		/** Depth values of frame i (points into the mapped file) */
+		const uint16_t* depthData(size_t i) const;
+
+		/** View of frame i without copying (points into the mapped file) */
+		RawFrameView frame(size_t i) const;
+
+		/** Color image of frame i (copied from the mapped file) */
+		slimage::Image3ub color(size_t i) const;
+
+		/** Depth image of frame i (copied from the mapped file) */
+		slimage::Image1ui16 depth(size_t i) const;
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> impl_;
+	};
+
+	/** Writes a raw RGB-D sequence frame by frame
+	 * The number of frames in the header is updated when the writer is closed or destroyed.
+	 * Throws std::runtime_error on write errors or if frame dimensions do not match.
+	 */
+	class RawSequenceWriter
+	{
+	public:
+		RawSequenceWriter(const std::string& filename, unsigned width, unsigned height);
+
+		~RawSequenceWriter();
+
+		RawSequenceWriter(const RawSequenceWriter&) = delete;
+		RawSequenceWriter& operator=(const RawSequenceWriter&) = delete;
+
+		/** Appends a frame */
+		void write(const slimage::Image3ub& color, const slimage::Image1ui16& depth);
+
+		/** Writes the header and closes the file */
+		void close();
+
+		size_t numFrames() const
+		{ return num_frames_; }
+
+	private:
+		void writeHeader();
+
+		std::ofstream ofs_;
+		unsigned width_, height_;
+		size_t num_frames_;
+	};
+
+}
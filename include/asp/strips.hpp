@@ -0,0 +1,163 @@
+#pragma once
+
+#include <asp/alic.hpp>
+#include <asp/execution.hpp>
+#include <asp/pds.hpp>
+#include <asp/segmentation.hpp>
+#include <slimage/image.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace asp {
+
+/** Parameters for out-of-core processing of large images in horizontal strips */
+struct StripParameters
+{
+	// number of image rows which are labeled per strip (the halo comes on top)
+	unsigned strip_height = 512;
+};
+
+namespace detail
+{
+	/** Mean density over the valid pixels in the footprint of a seed (same box as DensityIntegral::footprintMean)
+	 * 'window' holds the image rows starting at wy0 and must contain the footprint rows inside the image.
+	 * Pixels are summed in a fixed order, thus all windows which contain the footprint give the same result.
+	 */
+	template<typename T>
+	float WindowFootprintMean(const slimage::Image<Pixel<T>,1>& window, unsigned wy0, unsigned height, const Eigen::Vector2f& center, float density)
+	{
+		if(density <= 0.0f) {
+			return density;
+		}
+		const int width = window.width();
+		const float r = DensityToRadius(density);
+		auto clamp_floor = [](float v, int n) { return static_cast<int>(std::floor(std::min(std::max(v, 0.0f), static_cast<float>(n)))); };
+		auto clamp_ceil = [](float v, int n) { return static_cast<int>(std::ceil(std::min(std::max(v, 0.0f), static_cast<float>(n)))); };
+		const int x1 = clamp_floor(center.x() - r, width);
+		const int x2 = clamp_ceil(center.x() + r, width);
+		const int y1 = std::max(clamp_floor(center.y() - r, height), static_cast<int>(wy0));
+		const int y2 = std::min(clamp_ceil(center.y() + r, height), static_cast<int>(wy0 + window.height()));
+		double sum = 0.0;
+		unsigned count = 0;
+		for(int y=y1; y<y2; y++) {
+			for(int x=x1; x<x2; x++) {
+				const Pixel<T>& px = window(x, y - wy0);
+				if(px.valid()) {
+					sum += static_cast<double>(px.density);
+					count++;
+				}
+			}
+		}
+		return (count > 0) ? static_cast<float>(sum / static_cast<double>(count)) : 0.0f;
+	}
+}
+
+/** ALIC for images which do not fit into memory
+ * The image is processed in horizontal strips in two passes.
+ *
+ * The first pass streams the density of all strips through a PoissonDiskSampler, thus the seeds
+ * are the same as for the whole image. It also finds the bound R for superpixel radii: the density
+ * of a superpixel is the mean density of its pixels and never smaller than the smallest pixel density.
+ *
+ * The second pass runs ALIC per strip extended by a halo. A superpixel moves by at most lambda*R
+ * per iteration, thus all seeds within (iterations + 1)*lambda*R rows of the strip take part and
+ * superpixels seeded further away can not reach the strip. The halo adds R rows for the seed
+ * footprints, such that every seed gets the same density in all strips which use it.
+ * Superpixels in the outer part of the halo may still miss some of their pixels, which can
+ * change labels close to a seam in rare cases. If pixels have a density of 0, radii are not
+ * bounded and the halo covers the whole image.
+ *
+ * read(y_begin, y_end) must return the pixels for image rows [y_begin,y_end)
+ * with pixel positions relative to the strip, i.e. row y_begin has y = 0.
+ * write(y_begin, labels) is called once per strip in top to bottom order with
+ * the final superpixel ids for rows starting at y_begin.
+ *
+ * Peak memory is bounded by the size of one strip with halo and the superpixel list.
+ * The price is I/O: every strip is read once for seeding and once with halo for ALIC.
+ * Returns all superpixels in image coordinates. Each superpixel is computed by the
+ * strip which contains its seed.
+ */
+template<typename T, typename Read, typename Write, typename F>
+std::vector<Superpixel<T>> AlicStrips(unsigned width, unsigned height, PoissonDiskSamplingMethod method,
+	Read read, Write write, F dist,
+	const StripParameters& strip_opt=StripParameters(), const AlicParameters& opt=AlicParameters(),
+	const ExecutionContext& exec=ExecutionContext::Serial())
+{
+	const unsigned strip_height = std::max(strip_opt.strip_height, 1u);
+	// first pass: sample seeds for the whole image strip by strip and find the smallest density
+	std::vector<Eigen::Vector2f> positions;
+	PoissonDiskSampler sampler(method, width, height, exec);
+	float min_density = std::numeric_limits<float>::max();
+	for(unsigned y0=0; y0<height; y0+=strip_height) {
+		const unsigned y1 = std::min(y0 + strip_height, height);
+		const slimage::Image<Pixel<T>,1> strip = read(y0, y1);
+		Eigen::MatrixXf density{width, y1 - y0};
+		for(unsigned y=0; y<y1-y0; y++) {
+			for(unsigned x=0; x<width; x++) {
+				const Pixel<T>& px = strip(x,y);
+				density(x,y) = px.density;
+				if(px.valid() || px.density > 0.0f) {
+					min_density = std::min(min_density, px.density);
+				}
+			}
+		}
+		const std::vector<Eigen::Vector2f> strip_positions = sampler.add(density);
+		positions.insert(positions.end(), strip_positions.begin(), strip_positions.end());
+	}
+	// rows within which superpixels can reach a strip and the halo which also contains their footprints
+	const float max_radius = (min_density > 0.0f) ? detail::DensityToRadius(min_density) : std::numeric_limits<float>::infinity();
+	auto rows = [height](float v) {
+		return (v < static_cast<float>(height)) ? static_cast<unsigned>(std::ceil(v)) : height;
+	};
+	const unsigned reach = rows(opt.lambda * max_radius * static_cast<float>(opt.iterations + 1));
+	const unsigned halo = std::min(reach + rows(max_radius), height);
+	// second pass: run ALIC per strip with halo
+	std::vector<Superpixel<T>> superpixels(positions.size());
+	for(unsigned y0=0; y0<height; y0+=strip_height) {
+		const unsigned y1 = std::min(y0 + strip_height, height);
+		const unsigned wy0 = (y0 > halo) ? y0 - halo : 0;
+		const unsigned wy1 = std::min(y1 + halo, height);
+		const slimage::Image<Pixel<T>,1> window = read(wy0, wy1);
+		// collect seeds which can reach the strip
+		const float sy0 = static_cast<float>(y0) - static_cast<float>(reach);
+		const float sy1 = static_cast<float>(y1) + static_cast<float>(reach);
+		std::vector<size_t> ids;
+		std::vector<Seed> local_seeds;
+		for(size_t i=0; i<positions.size(); i++) {
+			const Eigen::Vector2f& p = positions[i];
+			if(sy0 <= p.y() && p.y() < sy1) {
+				Seed seed;
+				seed.position = { p.x(), p.y() - static_cast<float>(wy0) };
+				const float pixel_density = window(std::floor(seed.position.x()), std::floor(seed.position.y())).density;
+				seed.density = detail::WindowFootprintMean(window, wy0, height, p, pixel_density);
+				ids.push_back(i);
+				local_seeds.push_back(seed);
+			}
+		}
+		// compute superpixels for extended strip
+		const Segmentation<T> seg = ALIC(window, local_seeds, dist, opt, exec);
+		// write labels of the strip without halo using global superpixel ids
+		slimage::Image<int,1> labels{width, y1 - y0};
+		for(unsigned y=y0; y<y1; y++) {
+			for(unsigned x=0; x<width; x++) {
+				const int sid = seg.indices(x, y - wy0);
+				labels(x, y - y0) = (sid >= 0) ? static_cast<int>(ids[sid]) : -1;
+			}
+		}
+		write(y0, labels);
+		// keep superpixels which are seeded in this strip
+		for(size_t j=0; j<ids.size(); j++) {
+			const float y = positions[ids[j]].y();
+			if(static_cast<float>(y0) <= y && y < static_cast<float>(y1)) {
+				Superpixel<T> sp = seg.superpixels[j];
+				sp.position.y() += static_cast<float>(wy0);
+				superpixels[ids[j]] = sp;
+			}
+		}
+	}
+	return superpixels;
+}
+
+}
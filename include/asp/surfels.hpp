@@ -0,0 +1,95 @@
+#pragma once
+
+#include <asp/algos.hpp>
+#include <asp/execution.hpp>
+#include <slimage/image.hpp>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace asp
+{
+
+	/** DASP superpixel as an oriented 3D disc (packed, 36 bytes) */
+	struct Surfel
+	{
+		// mean 3D point in camera coordinates (meters)
+		float position[3];
+
+		// mean unit normal (pointing towards the camera)
+		float normal[3];
+
+		// radius of a disc with the same spatial spread as the superpixel pixels (meters)
+		float radius;
+
+		// mean color (RGB)
+		unsigned char color[3];
+
+		// reserved (0)
+		unsigned char flags;
+
+		// number of pixels
+		uint32_t num_pixels;
+	};
+
+	static_assert(sizeof(Surfel) == 36, "Surfel must be packed");
+
+	/** Covariance of the 3D points of a superpixel (upper triangle) */
+	struct SurfelCovariance
+	{
+		float xx, xy, xz, yy, yz, zz;
+	};
+
+	/** Surfels of one frame */
+	struct SurfelFrame
+	{
+		std::vector<Surfel> surfels;
+
+		// one entry per surfel if covariances were requested, otherwise empty
+		std::vector<SurfelCovariance> covariances;
+	};
+
+	/** DASP stage 3 which directly produces surfels
+	 * Point moments are gathered during the final ALIC accumulation, thus no pass over the
+	 * segmentation is needed afterwards. Superpixels without pixels are skipped.
+	 */
+	SurfelFrame DaspClusteringSurfels(const slimage::Image<Pixel<PixelRgbd>,1>& pixels, const std::vector<Seed>& seeds,
+		const DaspParameters& opt=DaspParameters(), bool with_covariance=false, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Depth-Adaptive Superpixels exported as surfels */
+	SurfelFrame SuperpixelsDaspSurfels(const slimage::Image3ub& color, const slimage::Image1ui16& depth,
+		const DaspParameters& opt=DaspParameters(), bool with_covariance=false, const ExecutionContext& exec=ExecutionContext::Serial());
+
+	/** Writes surfel frames to a binary stream, e.g. a file or a pipe to a mapping process
+	 * Each frame is written as
+	 *   magic "SURF", frame index (uint32), number of surfels (uint32), flags (uint32, bit 0: covariances)
+	 *   surfels (36 bytes each), covariances (24 bytes each, only if flag bit 0 is set)
+	 * in native byte order. The stream is flushed after each frame.
+	 */
+	class SurfelWriter
+	{
+	public:
+		/** The stream must outlive the writer
+		 * with_covariance sets flag bit 0 of all frames, thus every frame must have one covariance per surfel.
+		 */
+		explicit SurfelWriter(std::ostream& os, bool with_covariance=false);
+
+		/** Writes one frame
+		 * Throws std::runtime_error if the number of covariances does not match the writer (one per surfel
+		 * with covariances, none otherwise) and on write errors.
+		 */
+		void write(const SurfelFrame& frame);
+
+		bool withCovariance() const
+		{ return with_covariance_; }
+
+		size_t numFrames() const
+		{ return num_frames_; }
+
+	private:
+		std::ostream* os_;
+		bool with_covariance_;
+		size_t num_frames_;
+	};
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+namespace asp
+{
+
+	/** Non-owning view of pixel data with CC interleaved channels, e.g. of a NumPy array
+	 * Pixels are stored row by row without padding between rows.
+	 * The data is not copied and must stay valid while the view is used.
+	 */
+	template<typename K, unsigned CC>
+	struct ImageView
+	{
+		unsigned width = 0;
+		unsigned height = 0;
+		const K* data = nullptr;
+
+		/** Channels of pixel (x,y) */
+		const K* at(unsigned x, unsigned y) const
+		{ return data + CC*(static_cast<size_t>(y)*width + x); }
+	};
+
+	/** Interleaved RGB bytes */
+	using ColorView = ImageView<unsigned char,3>;
+
+	/** Density values (expected superpixels per pixel) */
+	using DensityView = ImageView<float,1>;
+
+}
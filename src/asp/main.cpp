@@ -1,11 +1,54 @@
 #include <asp/algos.hpp>
 #include <asp/plot.hpp>
+#include <asp/pipeline.hpp>
+#include <asp/sequence.hpp>
 #include <slimage/opencv.hpp>
 #include <slimage/io.hpp>
 #include <slimage/gui.hpp>
 #include <slimage/algorithm.hpp>
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cctype>
+#include <deque>
+#include <future>
+#include <utility>
+
+/** Path of frame i for printf style patterns (e.g. color_%04d.png), other paths are returned unchanged
+ * The pattern may contain %% and exactly one integer conversion %d, %i or %u with optional zero flag and width.
+ * The pattern is not passed to printf, so other conversions can not read arbitrary arguments.
+ */
+std::string FramePath(const std::string& pattern, unsigned i)
+{
+	std::ostringstream ss;
+	bool has_number = false;
+	for(size_t k=0; k<pattern.size(); k++) {
+		if(pattern[k] != '%') {
+			ss << pattern[k];
+			continue;
+		}
+		k++;
+		if(k < pattern.size() && pattern[k] == '%') {
+			ss << '%';
+			continue;
+		}
+		const bool zero = (k < pattern.size() && pattern[k] == '0');
+		unsigned width = 0;
+		while(k < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[k])) && width < 100) {
+			width = 10*width + static_cast<unsigned>(pattern[k] - '0');
+			k++;
+		}
+		if(has_number || k == pattern.size() || (pattern[k] != 'd' && pattern[k] != 'i' && pattern[k] != 'u')) {
+			throw std::runtime_error("Invalid frame path pattern '" + pattern + "': expected one integer conversion like %04d");
+		}
+		ss << std::setw(width) << std::setfill(zero ? '0' : ' ') << i;
+		has_number = true;
+	}
+	return ss.str();
+}
 
 int main(int argc, char** argv)
 {
@@ -14,6 +57,10 @@ int main(int argc, char** argv)
 	std::string p_fn_density;
 	std::string p_fn_depth;
 	std::string p_output;
+	unsigned p_threads;
+	std::string p_fn_sequence;
+	std::string p_fn_record;
+	unsigned p_num_frames;
 
 
 	namespace po = boost::program_options;
@@ -25,6 +72,10 @@ int main(int argc, char** argv)
 		("density", po::value(&p_fn_density), "path to input density image (required for ASP)")
 		("depth", po::value(&p_fn_depth), "path to input depth image (required for DASP)")
 		("output", po::value(&p_output)->default_value("/tmp/asp_"), "path/prefix for created images (optional)")
+		("threads", po::value(&p_threads)->default_value(0), "number of threads (0: one per core, 1: serial)")
+		("sequence", po::value(&p_fn_sequence), "path to raw RGB-D sequence which is processed with DASP (replaces color and depth)")
+		("record", po::value(&p_fn_record), "path to raw RGB-D sequence which is created from color and depth")
+		("frames", po::value(&p_num_frames)->default_value(1), "number of frames to record (color and depth may be printf patterns)")
 	;
 
 	po::variables_map vm;
@@ -35,16 +86,78 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
+	asp::ExecutionContext exec(p_threads);
+
+	if(!p_fn_record.empty()) {
+		// convert color and depth images into a raw sequence
+		std::unique_ptr<asp::RawSequenceWriter> writer;
+		for(unsigned i=0; i<p_num_frames; i++) {
+			slimage::Image3ub img_color = slimage::Load3ub(FramePath(p_fn_color, i));
+			slimage::Image1ui16 img_depth = slimage::Load1ui16(FramePath(p_fn_depth, i));
+			if(!writer) {
+				writer.reset(new asp::RawSequenceWriter(p_fn_record, img_color.width(), img_color.height()));
+			}
+			writer->write(img_color, img_depth);
+		}
+		if(writer) {
+			writer->close();
+			std::cout << "Recorded " << writer->numFrames() << " frames" << std::endl;
+		}
+		return 0;
+	}
+
+	if(p_method == "DASP" && !p_fn_sequence.empty()) {
+		// replay a raw sequence through the DASP pipeline without visualization
+		asp::RawSequenceReader reader(p_fn_sequence);
+		const auto t_begin = std::chrono::steady_clock::now();
+		size_t num_failed = 0;
+		{
+			asp::DaspPipeline pipeline(asp::DaspParameters(),
+				[](const asp::Segmentation<asp::PixelRgbd>&) {},
+				2, exec);
+			// frames finish in order, so only the futures of the frames in flight are kept
+			std::deque<std::pair<size_t,std::future<asp::Segmentation<asp::PixelRgbd>>>> pending;
+			auto finish_oldest = [&pending,&num_failed]() {
+				const size_t frame = pending.front().first;
+				try {
+					const asp::Segmentation<asp::PixelRgbd> sp = pending.front().second.get();
+					std::cout << "frame " << frame << ": " << sp.superpixels.size() << " superpixels" << std::endl;
+				}
+				catch(const std::exception& e) {
+					std::cerr << "frame " << frame << " failed: " << e.what() << std::endl;
+					num_failed++;
+				}
+				pending.pop_front();
+			};
+			for(size_t i=0; i<reader.numFrames(); i++) {
+				pending.emplace_back(i, pipeline.push(reader.frame(i)));
+				if(pending.size() > 4) {
+					finish_oldest();
+				}
+			}
+			while(!pending.empty()) {
+				finish_oldest();
+			}
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_begin).count();
+		std::cout << reader.numFrames() << " frames in " << seconds << " s";
+		if(num_failed > 0) {
+			std::cout << ", " << num_failed << " failed";
+		}
+		std::cout << std::endl;
+		return (num_failed > 0) ? 1 : 0;
+	}
+
 	if(p_method == "SLIC") {
 		// load data
 		slimage::Image3ub img_color = slimage::Load3ub(p_fn_color);
 		slimage::GuiShow("pixel color", img_color);
 		// compute superpixels
-		auto sp = asp::SuperpixelsSlic(img_color);
+		auto sp = asp::SuperpixelsSlic(img_color, asp::SlicParameters(), exec);
 		// visualize superpixels
 		auto vis_sp_color = VisualizeSuperpixelColor(sp);
 		slimage::GuiShow("SLIC superpixel", vis_sp_color);
-		auto graph = CreateSegmentBorderGraph(sp);
+		auto graph = CreateSegmentBorderGraph(sp, exec);
 		auto vis_sp_graph = VisualizeSuperpixelGraph(sp, graph);
 		slimage::GuiShow("SLIC superpixel (graph)", vis_sp_graph);
 		slimage::GuiWait();
@@ -67,13 +180,13 @@ int main(int argc, char** argv)
 			: slimage::Convert(slimage::Load1ui16(p_fn_density),
 				[](uint16_t v) { return 1.0f / static_cast<float>(v); });
 		// compute superpixels
-		auto sp = asp::SuperpixelsAsp(img_color, img_density);
+		auto sp = asp::SuperpixelsAsp(img_color, img_density, asp::AspParameters(), exec);
 		// visualize superpixels
 		auto vis_px_density = VisualizePixelDensity(sp);
 		slimage::GuiShow("pixel density", vis_px_density);
 		auto vis_sp_color = VisualizeSuperpixelColor(sp);
 		slimage::GuiShow("ASP superpixel", vis_sp_color);
-		auto graph = CreateSegmentBorderGraph(sp);
+		auto graph = CreateSegmentBorderGraph(sp, exec);
 		auto vis_sp_graph = VisualizeSuperpixelGraph(sp, graph);
 		slimage::GuiShow("ASP superpixel (graph)", vis_sp_graph);
 		slimage::GuiWait();		
@@ -95,7 +208,8 @@ int main(int argc, char** argv)
 				[](float v) { return asp::detail::uf32_to_ui08(v); });
 		slimage::GuiShow("pixel depth", vis_px_depth);
 		// compute superpixels
-		auto sp = asp::SuperpixelsDasp(img_color, img_depth);
+		auto sp = asp::SuperpixelsDasp(img_color, img_depth, asp::DaspParameters(), exec);
+		std::cout << sp.superpixels.size() << " superpixels" << std::endl;
 		// visualize superpixels
 		auto vis_px_density = VisualizePixelDensity(sp);
 		slimage::GuiShow("pixel density", vis_px_density);
@@ -106,7 +220,7 @@ int main(int argc, char** argv)
 		slimage::GuiShow("DASP superpixel (color)", vis_sp_color);
 		auto vis_sp_normals = VisualizeSuperpixelNormal(sp);
 		slimage::GuiShow("DASP superpixel (normal)", vis_sp_normals);
-		auto graph = CreateSegmentBorderGraph(sp);
+		auto graph = CreateSegmentBorderGraph(sp, exec);
 		auto vis_sp_graph = VisualizeSuperpixelGraph(sp, graph);
 		slimage::GuiShow("DASP superpixel (graph)", vis_sp_graph);
 		slimage::GuiWait();
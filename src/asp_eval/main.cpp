@@ -0,0 +1,119 @@
+#include <asp/algos.hpp>
+#include <asp/evaluation.hpp>
+#include <slimage/opencv.hpp>
+#include <slimage/io.hpp>
+#include <slimage/algorithm.hpp>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <chrono>
+
+/** Runs a superpixel method on one image and reports quality metrics next to runtime */
+int main(int argc, char** argv)
+{
+	std::string p_method;
+	std::string p_fn_color;
+	std::string p_fn_density;
+	std::string p_fn_depth;
+	std::string p_fn_ground_truth;
+	unsigned p_num_superpixels;
+	unsigned p_iterations;
+	unsigned p_stride;
+	bool p_boundary_refinement;
+	unsigned p_tolerance;
+	unsigned p_repeat;
+	unsigned p_threads;
+
+	namespace po = boost::program_options;
+	po::options_description desc;
+	desc.add_options()
+		("help", "produce help message")
+		("method", po::value(&p_method)->default_value("SLIC"), "superpixel method: SLIC, ASP, DASP")
+		("color", po::value(&p_fn_color), "path to input color image")
+		("density", po::value(&p_fn_density), "path to input density image (optional for ASP)")
+		("depth", po::value(&p_fn_depth), "path to input depth image (required for DASP)")
+		("ground-truth", po::value(&p_fn_ground_truth), "path to ground truth label image (16 bit)")
+		("num", po::value(&p_num_superpixels)->default_value(1000), "number of superpixels (SLIC and ASP without density)")
+		("iterations", po::value(&p_iterations)->default_value(5), "number of ALIC iterations")
+		("stride", po::value(&p_stride)->default_value(1), "ALIC pixel stride")
+		("boundary-refinement", po::value(&p_boundary_refinement)->default_value(false), "ALIC boundary refinement")
+		("tolerance", po::value(&p_tolerance)->default_value(2), "boundary recall tolerance in pixels")
+		("repeat", po::value(&p_repeat)->default_value(1), "number of runs for timing")
+		("threads", po::value(&p_threads)->default_value(0), "number of threads (0: one per core, 1: serial)")
+	;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+	if(vm.count("help") || p_fn_ground_truth.empty()) {
+		std::cerr << desc << std::endl;
+		return 1;
+	}
+
+	asp::ExecutionContext exec(p_threads);
+
+	asp::AlicParameters opt_alic;
+	opt_alic.iterations = p_iterations;
+	opt_alic.stride = p_stride;
+	opt_alic.boundary_refinement = p_boundary_refinement;
+
+	// load data
+	slimage::Image3ub img_color = slimage::Load3ub(p_fn_color);
+	slimage::Image<int,1> img_ground_truth = slimage::Convert(slimage::Load1ui16(p_fn_ground_truth),
+		[](uint16_t v) { return static_cast<int>(v); });
+	slimage::Image1ui16 img_depth;
+	if(p_method == "DASP") {
+		img_depth = slimage::Load1ui16(p_fn_depth);
+	}
+	slimage::Image1f img_density;
+	if(p_method == "ASP") {
+		img_density =
+			p_fn_density.empty()
+			? slimage::Image1f{img_color.dimensions(),
+				static_cast<float>(p_num_superpixels) / static_cast<float>(img_color.width()*img_color.height())}
+			: slimage::Convert(slimage::Load1ui16(p_fn_density),
+				[](uint16_t v) { return 1.0f / static_cast<float>(v); });
+	}
+
+	// compute superpixels
+	slimage::Image<int,1> labels;
+	double seconds = 0.0;
+	for(unsigned k=0; k<std::max(p_repeat, 1u); k++) {
+		const auto t_begin = std::chrono::steady_clock::now();
+		if(p_method == "SLIC") {
+			asp::SlicParameters opt;
+			opt.num_superpixels = p_num_superpixels;
+			opt.alic = opt_alic;
+			labels = asp::SuperpixelsSlic(img_color, opt, exec).indices;
+		}
+		else if(p_method == "ASP") {
+			asp::AspParameters opt;
+			opt.alic = opt_alic;
+			labels = asp::SuperpixelsAsp(img_color, img_density, opt, exec).indices;
+		}
+		else if(p_method == "DASP") {
+			asp::DaspParameters opt;
+			opt.alic = opt_alic;
+			labels = asp::SuperpixelsDasp(img_color, img_depth, opt, exec).indices;
+		}
+		else {
+			std::cerr << "Unknown method. Use --h for help." << std::endl;
+			return 1;
+		}
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t_begin).count();
+	}
+	seconds /= static_cast<double>(std::max(p_repeat, 1u));
+
+	// evaluate
+	asp::EvaluationParameters opt_eval;
+	opt_eval.boundary_tolerance = p_tolerance;
+	const asp::EvaluationResult r = asp::Evaluate(labels, img_ground_truth, opt_eval, exec);
+	std::cout << "method      " << p_method << std::endl;
+	std::cout << "superpixels " << r.num_superpixels << std::endl;
+	std::cout << "runtime     " << 1000.0*seconds << " ms" << std::endl;
+	std::cout << "BR          " << r.boundary_recall << std::endl;
+	std::cout << "UE          " << r.undersegmentation_error << std::endl;
+	std::cout << "ASA         " << r.achievable_segmentation_accuracy << std::endl;
+	std::cout << "CO          " << r.compactness << std::endl;
+
+	return 0;
+}
@@ -1,42 +1,151 @@
 #include <slimage/algorithm.hpp>
 #include <asp/algos.hpp>
 #include <asp/alic.hpp>
+#include "RgbPixel.hpp"
+#include <asp/algos_strips.hpp>
+#include <stdexcept>
 
 namespace asp
 {
 
-	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const AspParameters& opt)
-	{
-		constexpr PoissonDiskSamplingMethod PDS_METHOD = PoissonDiskSamplingMethod::FloydSteinbergExpo;
+	constexpr PoissonDiskSamplingMethod ASP_PDS_METHOD = PoissonDiskSamplingMethod::FloydSteinbergExpo;
 
-		auto img_data = slimage::ConvertUV(color,
+	/** Computes ASP pixels from color and density */
+	slimage::Image<Pixel<PixelRgb>,1> AspPixels(const slimage::Image3ub& color, const slimage::Image1f& density)
+	{
+		return slimage::ConvertUV(color,
 			[&density](unsigned x, unsigned y, const slimage::Pixel3ub& px) {
-				return Pixel<PixelRgb>{
-					1.0f,
-					{
-						static_cast<float>(x),
-						static_cast<float>(y)
-					},
-					density(x,y),
-					{
-						Eigen::Vector3f{
-							static_cast<float>(px[0]),
-							static_cast<float>(px[1]),
-							static_cast<float>(px[2])
-						}/255.0f
-					}
-				};
+				return detail::RgbPixel(x, y, px, density(x,y));
 			});
+	}
 
+	/** ASP clustering of pixels */
+	Segmentation<PixelRgb> AspClustering(const slimage::Image<Pixel<PixelRgb>,1>& img_data, const AspParameters& opt, const ExecutionContext& exec)
+	{
 		auto sp = ALIC(img_data,
-			ComputeSeeds(PDS_METHOD, img_data),
-			[COMPACTNESS=opt.compactness](const Superpixel<PixelRgb>& a, const Pixel<PixelRgb>& b) {
-				return COMPACTNESS * (a.position - b.position).squaredNorm() / (a.radius * a.radius)
-					+ (1.0f - COMPACTNESS) * (a.data.color - b.data.color).squaredNorm();
-			});
+			ComputeSeeds(ASP_PDS_METHOD, img_data, exec),
+			PixelRgbDistance{opt.compactness},
+			opt.alic,
+			exec);
 
 		return sp;
 	}
 
+	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const AspParameters& opt, const ExecutionContext& exec)
+	{
+		return AspClustering(AspPixels(color, density), opt, exec);
+	}
+
+	Segmentation<PixelRgb> SuperpixelsAsp(const ColorView& color, const DensityView& density, const AspParameters& opt, const ExecutionContext& exec)
+	{
+		if(color.width != density.width || color.height != density.height) {
+			throw std::runtime_error("SuperpixelsAsp: color and density must have the same size");
+		}
+		return AspClustering(
+			detail::RgbPixels(color, [&density](unsigned x, unsigned y) { return *density.at(x,y); }),
+			opt, exec);
+	}
+
+	/** ASP superpixels for the mask pixels in the given boxes which must not overlap */
+	Segmentation<PixelRgb> SuperpixelsAspRegions(const slimage::Image3ub& color, const slimage::Image1f& density, const slimage::Image1ub& mask, const std::vector<Roi>& boxes, const AspParameters& opt, const ExecutionContext& exec)
+	{
+		const auto regions = detail::MaskedRegionPixels(mask, boxes, Pixel<PixelRgb>::Zero(),
+			[&color,&density](unsigned x, unsigned y) {
+				return detail::RgbPixel(x, y, color(x,y), density(x,y));
+			},
+			exec);
+		return detail::MaskedAlic(regions, color.width(), color.height(),
+			ASP_PDS_METHOD,
+			PixelRgbDistance{opt.compactness},
+			opt.alic,
+			exec);
+	}
+
+	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const slimage::Image1ub& mask, const AspParameters& opt, const ExecutionContext& exec)
+	{
+		detail::CheckMaskSize(mask, color.width(), color.height());
+		return SuperpixelsAspRegions(color, density, mask, MaskRegions(mask, exec), opt, exec);
+	}
+
+	Segmentation<PixelRgb> SuperpixelsAsp(const slimage::Image3ub& color, const slimage::Image1f& density, const std::vector<Roi>& rois, const AspParameters& opt, const ExecutionContext& exec)
+	{
+		const unsigned width = color.width();
+		const unsigned height = color.height();
+		return SuperpixelsAspRegions(color, density, RoiMask(width, height, rois), MergeRois(width, height, rois), opt, exec);
+	}
+
+	std::vector<Superpixel<PixelRgb>> SuperpixelsAspStrips(unsigned width, unsigned height,
+		const std::function<slimage::Image3ub(unsigned,unsigned)>& read_color,
+		const std::function<slimage::Image1f(unsigned,unsigned)>& read_density,
+		const std::function<void(unsigned,const slimage::Image<int,1>&)>& write_labels,
+		const AspParameters& opt, const StripParameters& strip_opt,
+		const ExecutionContext& exec)
+	{
+		return AlicStrips<PixelRgb>(width, height, ASP_PDS_METHOD,
+			[&read_color,&read_density](unsigned y_begin, unsigned y_end) {
+				return AspPixels(read_color(y_begin, y_end), read_density(y_begin, y_end));
+			},
+			write_labels,
+			PixelRgbDistance{opt.compactness},
+			strip_opt,
+			opt.alic,
+			exec);
+	}
+
+	/** Recomputes the ASP pixels marked in 'changed' (ASP pixel features only depend on the pixel itself) */
+	void UpdateAspPixels(const slimage::Image<Pixel<PixelRgb>,1>& pixels, const slimage::Image3ub& color, const slimage::Image1f& density, const slimage::Image1ub& changed, const ExecutionContext& exec)
+	{
+		const Roi box = MaskBoundingBox(changed, exec);
+		const size_t num_bands = exec.numChunks(box.height);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const unsigned y1 = box.y + detail::ChunkBegin(box.height, num_bands, band);
+			const unsigned y2 = box.y + detail::ChunkBegin(box.height, num_bands, band + 1);
+			for(unsigned y=y1; y<y2; y++) {
+				for(unsigned x=box.x; x<box.x + box.width; x++) {
+					if(changed(x,y)) {
+						pixels(x,y) = detail::RgbPixel(x, y, color(x,y), density(x,y));
+					}
+				}
+			}
+		});
+	}
+
+	slimage::Image1ub AspChangeMask(const Segmentation<PixelRgb>& previous, const slimage::Image3ub& color, const slimage::Image1f& density, float color_threshold, float density_threshold, const ExecutionContext& exec)
+	{
+		const unsigned width = color.width();
+		const unsigned height = color.height();
+		slimage::Image1ub changed{width, height};
+		const size_t num_bands = exec.numChunks(height);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+			const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+			for(unsigned y=y1; y<y2; y++) {
+				for(unsigned x=0; x<width; x++) {
+					const auto& prev = previous.input(x,y);
+					const Pixel<PixelRgb> px = detail::RgbPixel(x, y, color(x,y), density(x,y));
+					changed(x,y) = (
+						(px.data.color - prev.data.color).cwiseAbs().maxCoeff() > color_threshold
+						|| std::abs(px.density - prev.density) > density_threshold*std::max(px.density, prev.density)
+					) ? 1 : 0;
+				}
+			}
+		});
+		return changed;
+	}
+
+	Segmentation<PixelRgb> SuperpixelsAspUpdate(const Segmentation<PixelRgb>& previous, const slimage::Image3ub& color, const slimage::Image1f& density, const slimage::Image1ub& changed, const AspParameters& opt, const ExecutionContext& exec)
+	{
+		auto img_data = slimage::Image<Pixel<PixelRgb>,1>{color.width(), color.height()};
+		std::copy(previous.input.begin(), previous.input.end(), img_data.begin());
+		UpdateAspPixels(img_data, color, density, changed, exec);
+		return ALICUpdate(previous, img_data, changed, PixelRgbDistance{opt.compactness}, opt.alic, exec);
+	}
+
+	Segmentation<PixelRgb> SuperpixelsAspUpdate(Segmentation<PixelRgb>&& previous, const slimage::Image3ub& color, const slimage::Image1f& density, const slimage::Image1ub& changed, const AspParameters& opt, const ExecutionContext& exec)
+	{
+		UpdateAspPixels(previous.input, color, density, changed, exec);
+		return ALICUpdate(std::move(previous), changed, PixelRgbDistance{opt.compactness}, opt.alic, exec);
+	}
+
 
-}
\ No newline at end of file
+}
@@ -1,14 +1,18 @@
 #include <asp/algos.hpp>
 #include <asp/alic.hpp>
+#include <asp/hierarchy.hpp>
+#include <asp/surfels.hpp>
+#include <asp/isa.hpp>
 #include <slimage/image.hpp>
 #include <Eigen/Dense>
-#include <iostream>
 #include <cmath>
+#include <algorithm>
 
 namespace asp
 {
 
 	/** Computes first derivative for 5 evenly spaced depth samples (v0,...,v4) */
+	ASP_KERNEL inline
 	float LocalFiniteDifferencesPrimesense(uint16_t v0, uint16_t v1, uint16_t v2, uint16_t v3, uint16_t v4)
 	{
 		const float v0f = static_cast<float>(v0);
@@ -48,49 +52,67 @@ namespace asp
 		}
 	}
 
-	/** Computes depth gradient for pixel (j,i) */
-	Eigen::Vector2f LocalDepthGradient(const slimage::Image1ui16& depth, unsigned int j, unsigned int i, const DaspParameters& opt)
+	/** Even window size in pixels (at least 4) for the depth gradient along an axis
+	 * z_over_f is the metric size of one pixel along this axis.
+	 */
+	ASP_KERNEL inline
+	unsigned int DepthGradientWindow(float z_over_f, float radius)
 	{
-		uint16_t d00 = depth(j,i);
-
-		float z_over_f = static_cast<float>(d00) * opt.depth_to_z / opt.focal_px;
-		float window = 0.1f * opt.radius / z_over_f;
-
-		// compute w = base_scale*f/d
+		float window = 0.1f * radius / z_over_f;
 		unsigned int w = std::max(static_cast<unsigned int>(window + 0.5f), 4u);
 		if(w % 2 == 1) w++;
+		return w;
+	}
+
+	/** Computes depth gradient for pixel (j,i)
+	 * The x and y derivatives use the focal lengths fx and fy of the camera.
+	 * Depth is a slimage::Image1ui16 or another type with width(), height() and depth(x,y).
+	 */
+	template<typename Depth>
+	ASP_KERNEL inline
+	Eigen::Vector2f LocalDepthGradient(const Depth& depth, unsigned int j, unsigned int i, const DaspCamera& cam)
+	{
+		uint16_t d00 = depth(j,i);
+
+		// compute w = base_scale*f/d per axis
+		float zx_over_f = static_cast<float>(d00) * cam.depth_to_z / cam.fx;
+		float zy_over_f = static_cast<float>(d00) * cam.depth_to_z / cam.fy;
+		unsigned int wx = DepthGradientWindow(zx_over_f, cam.radius);
+		unsigned int wy = DepthGradientWindow(zy_over_f, cam.radius);
 
 		// can not compute the gradient at the border, so return 0
-		if(i < w || depth.height() - w <= i || j < w || depth.width() - w <= j) {
+		if(i < wy || depth.height() - wy <= i || j < wx || depth.width() - wx <= j) {
 			return Eigen::Vector2f::Zero();
 		}
 
 		float dx = LocalFiniteDifferencesPrimesense(
-			depth(j-w,i),
-			depth(j-w/2,i),
+			depth(j-wx,i),
+			depth(j-wx/2,i),
 			d00,
-			depth(j+w/2,i),
-			depth(j+w,i)
+			depth(j+wx/2,i),
+			depth(j+wx,i)
 		);
 
 		float dy = LocalFiniteDifferencesPrimesense(
-			depth(j,i-w),
-			depth(j,i-w/2),
+			depth(j,i-wy),
+			depth(j,i-wy/2),
 			d00,
-			depth(j,i+w/2),
-			depth(j,i+w)
+			depth(j,i+wy/2),
+			depth(j,i+wy)
 		);
 
 		// Theoretically scale == base_scale, but w must be an integer, so we
 		// compute scale from the actually used w.
 
 		// compute 1 / scale = 1 / (w*d/f)
-		float scl = 1.0f / (float(w) * z_over_f);
+		float sclx = 1.0f / (float(wx) * zx_over_f);
+		float scly = 1.0f / (float(wy) * zy_over_f);
 
-		return (scl*opt.depth_to_z) * Eigen::Vector2f(static_cast<float>(dx), static_cast<float>(dy));
+		return cam.depth_to_z * Eigen::Vector2f(sclx * static_cast<float>(dx), scly * static_cast<float>(dy));
 	}
 
 	/** Computes normal from gradient and assures that it points towards the camera (which is in 0) */
+	ASP_KERNEL inline
 	Eigen::Vector3f NormalFromGradient(const Eigen::Vector2f& g, const Eigen::Vector3f& position)
 	{
 		const float gx = g.x();
@@ -108,17 +130,57 @@ namespace asp
 		return normal;
 	}
 
-	/** Computes 3D point for a pixel */
-	Eigen::Vector3f Backproject(const Eigen::Vector2f& pos, const Eigen::Vector2f& center, float depth, const DaspParameters& opt)
+	/** Effective focal lengths and principal point (fx, fy, cx, cy) */
+	Eigen::Vector4f CameraIntrinsics(unsigned width, unsigned height, const DaspParameters& opt)
+	{
+		return {
+			opt.focal_px,
+			opt.focal_px_y > 0.0f ? opt.focal_px_y : opt.focal_px,
+			opt.center_x >= 0.0f ? opt.center_x : 0.5f * static_cast<float>(width),
+			opt.center_y >= 0.0f ? opt.center_y : 0.5f * static_cast<float>(height)
+		};
+	}
+
+	DaspCamera::DaspCamera(unsigned width, unsigned height, const DaspParameters& opt)
+	:	width(width), height(height), depth_to_z(opt.depth_to_z), radius(opt.radius)
+	{
+		const Eigen::Vector4f intrinsics = CameraIntrinsics(width, height, opt);
+		fx = intrinsics[0];
+		fy = intrinsics[1];
+		cx = intrinsics[2];
+		cy = intrinsics[3];
+		ray_x.resize(width);
+		for(unsigned x=0; x<width; x++) {
+			ray_x[x] = depth_to_z * (static_cast<float>(x) - cx) / fx;
+		}
+		ray_y.resize(height);
+		for(unsigned y=0; y<height; y++) {
+			ray_y[y] = depth_to_z * (static_cast<float>(y) - cy) / fy;
+		}
+		ray_z = depth_to_z;
+		// a pixel at depth z covers (z/fx)*(z/fy) square meters and a superpixel pi*r*r square meters
+		density_scale = depth_to_z * depth_to_z / (radius * radius * fx * fy * 3.1415f);
+	}
+
+	bool DaspCamera::matches(unsigned w, unsigned h, const DaspParameters& opt) const
+	{
+		return width == w && height == h
+			&& Eigen::Vector4f{fx, fy, cx, cy} == CameraIntrinsics(w, h, opt)
+			&& depth_to_z == opt.depth_to_z && radius == opt.radius;
+	}
+
+	/** Computes 3D point for a pixel with raw depth value */
+	ASP_KERNEL inline
+	Eigen::Vector3f Backproject(const DaspCamera& cam, unsigned x, unsigned y, float raw_depth)
 	{
-		return (depth / opt.focal_px) * Eigen::Vector3f{ pos.x() - center.x(), pos.y() - center.y(), opt.focal_px };
+		return raw_depth * Eigen::Vector3f{ cam.ray_x[x], cam.ray_y[y], cam.ray_z };
 	}
 
-	/** Computes DASP density */
-	float Density(float depth, const Eigen::Vector2f& gradient, const DaspParameters& opt)
+	/** Computes DASP density for a pixel with raw depth value */
+	ASP_KERNEL inline
+	float Density(const DaspCamera& cam, float raw_depth, const Eigen::Vector2f& gradient)
 	{
-		float q = depth / (opt.radius * opt.focal_px);
-		return q * q / 3.1415f * std::sqrt(gradient.squaredNorm() + 1.0f);
+		return raw_depth * raw_depth * cam.density_scale * std::sqrt(gradient.squaredNorm() + 1.0f);
 	}
 
 	/** Normal distance function */
@@ -128,73 +190,530 @@ namespace asp
 		return 1.0f - a.dot(b);
 	}
 
-	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const DaspParameters& opt_in)
+	/** Feature distances and setters which are no-ops for disabled pixel features */
+	inline float ColorDistance(const detail::RgbdColorPart<true>& a, const detail::RgbdColorPart<true>& b)
+	{ return (a.color - b.color).squaredNorm(); }
+
+	inline float ColorDistance(const detail::RgbdColorPart<false>&, const detail::RgbdColorPart<false>&)
+	{ return 0.0f; }
+
+	inline float WorldDistance(const detail::RgbdWorldPart<true>& a, const detail::RgbdWorldPart<true>& b)
+	{ return (a.world - b.world).squaredNorm(); }
+
+	inline float WorldDistance(const detail::RgbdWorldPart<false>&, const detail::RgbdWorldPart<false>&)
+	{ return 0.0f; }
+
+	inline float NormalDistance(const detail::RgbdNormalPart<true>& a, const detail::RgbdNormalPart<true>& b)
+	{ return NormalDistance(a.normal, b.normal); }
+
+	inline float NormalDistance(const detail::RgbdNormalPart<false>&, const detail::RgbdNormalPart<false>&)
+	{ return 0.0f; }
+
+	inline void SetColor(detail::RgbdColorPart<true>& p, const Eigen::Vector3f& color) { p.color = color; }
+	inline void SetColor(detail::RgbdColorPart<false>&, const Eigen::Vector3f&) {}
+	inline void SetDepth(detail::RgbdDepthPart<true>& p, float depth) { p.depth = depth; }
+	inline void SetDepth(detail::RgbdDepthPart<false>&, float) {}
+	inline void SetWorld(detail::RgbdWorldPart<true>& p, const Eigen::Vector3f& world) { p.world = world; }
+	inline void SetWorld(detail::RgbdWorldPart<false>&, const Eigen::Vector3f&) {}
+	inline void SetNormal(detail::RgbdNormalPart<true>& p, const Eigen::Vector3f& normal) { p.normal = normal; }
+	inline void SetNormal(detail::RgbdNormalPart<false>&, const Eigen::Vector3f&) {}
+	inline Eigen::Vector3f GetColor(const detail::RgbdColorPart<true>& p) { return p.color; }
+	inline Eigen::Vector3f GetColor(const detail::RgbdColorPart<false>&) { return Eigen::Vector3f::Zero(); }
+	inline Eigen::Vector3f GetNormal(const detail::RgbdNormalPart<true>& p) { return p.normal; }
+	inline Eigen::Vector3f GetNormal(const detail::RgbdNormalPart<false>&) { return Eigen::Vector3f(0.0f, 0.0f, -1.0f); }
+
+	/** Color and depth of a frame view with the accessors of slimage images */
+	struct FrameViewColor
+	{
+		const RawFrameView& frame;
+
+		const unsigned char* operator()(unsigned x, unsigned y) const
+		{ return frame.colorAt(x,y); }
+	};
+
+	struct FrameViewDepth
+	{
+		const RawFrameView& frame;
+
+		unsigned width() const
+		{ return frame.width; }
+
+		unsigned height() const
+		{ return frame.height; }
+
+		uint16_t operator()(unsigned x, unsigned y) const
+		{ return frame.depthAt(x,y); }
+	};
+
+	/** Computes DASP pixel features for pixel (x,y)
+	 * Only enabled features are computed. The depth gradient is always needed for the density.
+	 * Color and Depth are slimage images or the frame view accessors above.
+	 */
+	template<unsigned F, typename Color, typename Depth>
+	ASP_KERNEL inline
+	void DaspPixel(const Color& img_rgb, const Depth& img_d, const DaspCamera& cam, const DaspParameters& opt, unsigned x, unsigned y, Pixel<PixelRgbdF<F>>& q)
+	{
+		using P = PixelRgbdF<F>;
+		auto idepth = img_d(x,y);
+		q.position = { static_cast<float>(x), static_cast<float>(y) };
+		if(P::has_color) {
+			const auto& rgb = img_rgb(x,y);
+			SetColor(q.data, Eigen::Vector3f{ static_cast<float>(rgb[0]), static_cast<float>(rgb[1]), static_cast<float>(rgb[2]) }/255.0f);
+		}
+		if(idepth == 0) {
+			// invalid pixel
+			q.num = 0.0f;
+			SetDepth(q.data, 0.0f);
+			SetWorld(q.data, Eigen::Vector3f::Zero());
+			q.density = 0.0f;
+			SetNormal(q.data, Eigen::Vector3f(0.0f, 0.0f, -1.0f));
+		}
+		else {
+			// normal pixel
+			q.num = 1.0f;
+			const float raw_depth = static_cast<float>(idepth);
+			SetDepth(q.data, raw_depth * opt.depth_to_z);
+			const Eigen::Vector3f world = Backproject(cam, x, y, raw_depth);
+			SetWorld(q.data, world);
+			Eigen::Vector2f gradient = LocalDepthGradient(img_d, x, y, cam);
+			q.density = Density(cam, raw_depth, gradient);
+			if(P::has_normal) {
+				SetNormal(q.data, NormalFromGradient(gradient, world));
+			}
+		}
+	}
+
+	/** Computes DASP pixels with the features F
+	 * If density_scale is not null it receives the factor which was applied to the pixel densities.
+	 */
+	template<unsigned F, typename Color, typename Depth>
+	slimage::Image<Pixel<PixelRgbdF<F>>,1> DaspPixelsF(const Color& img_rgb, const Depth& img_d, const DaspCamera& cam, const DaspParameters& opt_in, const ExecutionContext& exec,
+		float* density_scale=nullptr)
 	{
-		constexpr PoissonDiskSamplingMethod PDS_METHOD = PoissonDiskSamplingMethod::FloydSteinbergExpo;
 		const DaspParameters opt = opt_in; // use local copy for higher performance
-		const unsigned width = img_rgb.width();
+		const unsigned width = img_d.width();
 		const unsigned height = img_d.height();
-		const Eigen::Vector2f cam_center = 0.5f * Eigen::Vector2f{ static_cast<float>(width), static_cast<float>(height) };
-
-		slimage::Image<Pixel<PixelRgbd>,1> img_data{width, height};
-		for(unsigned y=0, i=0; y<height; y++) {
-			for(unsigned x=0; x<width; x++, i++) {
-				const auto& rgb = img_rgb(x,y);
-				auto idepth = img_d(x,y);
-				Pixel<PixelRgbd>& q = img_data(x,y);
-				q.position = { static_cast<float>(x), static_cast<float>(y) };
-				q.data.color = Eigen::Vector3f{ static_cast<float>(rgb[0]), static_cast<float>(rgb[1]), static_cast<float>(rgb[2]) }/255.0f;
-				if(idepth == 0) {
-					// invalid pixel
-					q.num = 0.0f;
-					q.data.depth = 0.0f;
-					q.data.world = Eigen::Vector3f::Zero();
-					Eigen::Vector2f gradient = Eigen::Vector2f::Zero();
-					q.density = 0.0f;
-					q.data.normal = Eigen::Vector3f(0.0f, 0.0f, -1.0f);
+
+		slimage::Image<Pixel<PixelRgbdF<F>>,1> img_data{width, height};
+		const size_t num_bands = exec.numChunks(height);
+		// total density = number of superpixels (summed per band while computing pixels)
+		std::vector<double> band_density(num_bands, 0.0);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+			const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+			double total_density = 0.0;
+			detail::IsaDispatch([&]() ASP_KERNEL {
+				for(unsigned y=y1; y<y2; y++) {
+					for(unsigned x=0; x<width; x++) {
+						Pixel<PixelRgbdF<F>>& q = img_data(x,y);
+						DaspPixel(img_rgb, img_d, cam, opt, x, y, q);
+						total_density += q.density;
+					}
 				}
-				else {
-					// normal pixel
-					q.num = 1.0f;
-					q.data.depth = static_cast<float>(idepth) * opt.depth_to_z;
-					q.data.world = Backproject(q.position, cam_center, q.data.depth, opt);
-					Eigen::Vector2f gradient = LocalDepthGradient(img_d, x, y, opt);
-					q.density = Density(q.data.depth, gradient, opt);
-					q.data.normal = NormalFromGradient(gradient, q.data.world);
+			});
+			band_density[band] = total_density;
+		});
+
+		float density_scale_factor = 1.0f;
+		if(opt.num_superpixels > 0) {
+			double total_density = 0.0;
+			for(double v : band_density) {
+				total_density += v;
+			}
+			if(total_density > 0.0) {
+				// compute density scale factor
+				density_scale_factor = static_cast<float>(static_cast<double>(opt.num_superpixels) / total_density);
+				// scale density
+				for(auto& q : img_data) {
+					q.density *= density_scale_factor;
 				}
 			}
 		}
+		if(density_scale) {
+			*density_scale = density_scale_factor;
+		}
+
+		return img_data;
+	}
+
+	slimage::Image<Pixel<PixelRgbd>,1> DaspPixels(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		return DaspPixels(img_rgb, img_d, DaspCamera(img_d.width(), img_d.height(), opt), opt, exec);
+	}
+
+	slimage::Image<Pixel<PixelRgbd>,1> DaspPixels(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const DaspCamera& cam, const DaspParameters& opt, const ExecutionContext& exec, float* density_scale)
+	{
+		return DaspPixelsF<RgbdAll>(img_rgb, img_d, cam, opt, exec, density_scale);
+	}
+
+	slimage::Image<Pixel<PixelRgbd>,1> DaspPixels(const RawFrameView& frame, const DaspCamera& cam, const DaspParameters& opt, const ExecutionContext& exec, float* density_scale)
+	{
+		return DaspPixelsF<RgbdAll>(FrameViewColor{frame}, FrameViewDepth{frame}, cam, opt, exec, density_scale);
+	}
+
+	std::vector<Seed> DaspSeeds(const slimage::Image<Pixel<PixelRgbd>,1>& pixels, const ExecutionContext& exec)
+	{
+		constexpr PoissonDiskSamplingMethod PDS_METHOD = PoissonDiskSamplingMethod::FloydSteinbergExpo;
+		return ComputeSeeds(PDS_METHOD, pixels, exec);
+	}
+
+	/** DASP distance function for pixels with the features F (disabled features contribute 0) */
+	template<unsigned F>
+	struct DaspDistanceF
+	{
+		float compactness;
+		float normal_weight;
+		float radius_scl;
+
+		DaspDistanceF(const DaspParameters& opt)
+		:	compactness(opt.compactness),
+			normal_weight(opt.normal_weight),
+			radius_scl(1.0f/(opt.radius*opt.radius))
+		{}
+
+		float operator()(const Superpixel<PixelRgbdF<F>>& a, const Pixel<PixelRgbdF<F>>& b) const
+		{
+			return
+				compactness * WorldDistance(a.data, b.data) * radius_scl
+				+ (1.0f - compactness) * (
+					(1.0f - normal_weight) * ColorDistance(a.data, b.data)
+					+ normal_weight * NormalDistance(a.data, b.data)
+				);
+		}
+	};
+
+	using DaspDistance = DaspDistanceF<RgbdAll>;
 
+	Segmentation<PixelRgbd> DaspClustering(const slimage::Image<Pixel<PixelRgbd>,1>& pixels, const std::vector<Seed>& seeds, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		return ALIC(pixels, seeds, DaspDistance(opt), opt.alic, exec);
+	}
+
+	unsigned DaspRequiredFeatures(const DaspParameters& opt)
+	{
+		// world coordinates are part of every DASP superpixel (and used for the seeds radius)
+		unsigned features = RgbdWorld;
+		if(opt.compactness < 1.0f && opt.normal_weight < 1.0f) {
+			features |= RgbdColor;
+		}
+		if(opt.compactness < 1.0f && opt.normal_weight > 0.0f) {
+			features |= RgbdNormal;
+		}
+		return features;
+	}
+
+	/** DASP superpixels with the features F for images or frame view accessors (see DaspPixel) */
+	template<unsigned F, typename Color, typename Depth>
+	Segmentation<PixelRgbdF<F>> DaspSegmentationF(const Color& img_rgb, const Depth& img_d, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		float density_scale = 1.0f;
+		auto img_data = DaspPixelsF<F>(img_rgb, img_d, DaspCamera(img_d.width(), img_d.height(), opt), opt, exec, &density_scale);
+		auto seeds = ComputeSeeds(PoissonDiskSamplingMethod::FloydSteinbergExpo, img_data, exec);
+		Segmentation<PixelRgbdF<F>> seg = ALIC(img_data, seeds, DaspDistanceF<F>(opt), opt.alic, exec);
+		seg.density_scale = density_scale;
+		return seg;
+	}
+
+	template<unsigned F>
+	Segmentation<PixelRgbdF<F>> SuperpixelsDaspF(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		return DaspSegmentationF<F>(img_rgb, img_d, opt, exec);
+	}
+
+	/** Copies a DASP pixel with the features F into a pixel with all features
+	 * Depth is the z coordinate of the 3D point, missing color is black and missing normals face the camera.
+	 */
+	template<unsigned F>
+	void ExpandDaspPixel(const SegmentBase<PixelRgbdF<F>>& p, SegmentBase<PixelRgbd>& q)
+	{
+		q.num = p.num;
+		q.position = p.position;
+		q.density = p.density;
+		q.data.color = GetColor(p.data);
+		q.data.world = p.data.world;
+		q.data.depth = q.data.world.z();
+		q.data.normal = GetNormal(p.data);
+	}
+
+	/** Converts a DASP segmentation with the features F into a segmentation with all features (see ExpandDaspPixel)
+	 * The call operator accepts segmentations of all feature sets.
+	 */
+	struct ExpandDaspSegmentation
+	{
+		Segmentation<PixelRgbd>& result;
+		const ExecutionContext& exec;
+
+		template<unsigned F>
+		void operator()(Segmentation<PixelRgbdF<F>>&& s) const
+		{
+			const unsigned width = s.input.width();
+			const unsigned height = s.input.height();
+			result.input = slimage::Image<Pixel<PixelRgbd>,1>{width, height};
+			const size_t num_bands = exec.numChunks(height);
+			exec.parallel_for(num_bands, [&](size_t band) {
+				const size_t i1 = detail::ChunkBegin(height, num_bands, band)*width;
+				const size_t i2 = detail::ChunkBegin(height, num_bands, band + 1)*width;
+				for(size_t i=i1; i<i2; i++) {
+					ExpandDaspPixel<F>(s.input[i], result.input[i]);
+				}
+			});
+			result.superpixels.resize(s.superpixels.size());
+			for(size_t i=0; i<s.superpixels.size(); i++) {
+				ExpandDaspPixel<F>(s.superpixels[i], result.superpixels[i]);
+				result.superpixels[i].radius = s.superpixels[i].radius;
+			}
+			result.indices = s.indices;
+			result.weights = s.weights;
+			result.density_scale = s.density_scale;
+			result.iterations = s.iterations;
+			result.deadline_exceeded = s.deadline_exceeded;
+			result.membership = std::move(s.membership);
+		}
+	};
+
+	/** DASP superpixels with the pixel features needed for the parameters (see SuperpixelsDasp) */
+	template<typename Color, typename Depth>
+	Segmentation<PixelRgbd> DaspSegmentation(const Color& img_rgb, const Depth& img_d, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		// without iterations superpixels are the seed pixels and clustering does not profit from fewer features,
+		// with the default parameters only depth could be dropped which does not pay for the conversion
+		const unsigned features = DaspRequiredFeatures(opt);
+		if(opt.full_feature_means || opt.alic.iterations == 0 || features == (RgbdWorld | RgbdColor | RgbdNormal)) {
+			return DaspSegmentationF<RgbdAll>(img_rgb, img_d, opt, exec);
+		}
+		Segmentation<PixelRgbd> s;
+		const ExpandDaspSegmentation expand{s, exec};
+		switch(features) {
+		case RgbdWorld:
+			expand(DaspSegmentationF<RgbdWorld>(img_rgb, img_d, opt, exec));
+			break;
+		case RgbdWorld | RgbdColor:
+			expand(DaspSegmentationF<RgbdWorld | RgbdColor>(img_rgb, img_d, opt, exec));
+			break;
+		default: // RgbdWorld | RgbdNormal
+			expand(DaspSegmentationF<RgbdWorld | RgbdNormal>(img_rgb, img_d, opt, exec));
+			break;
+		}
+		return s;
+	}
+
+	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		return DaspSegmentation(img_rgb, img_d, opt, exec);
+	}
+
+	Segmentation<PixelRgbd> SuperpixelsDasp(const RawFrameView& frame, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		return DaspSegmentation(FrameViewColor{frame}, FrameViewDepth{frame}, opt, exec);
+	}
+
+	/** DASP superpixels for the mask pixels in the given boxes which must not overlap */
+	Segmentation<PixelRgbd> SuperpixelsDaspRegions(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const slimage::Image1ub& mask, const std::vector<Roi>& boxes, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		const DaspCamera cam(img_d.width(), img_d.height(), opt);
+		// pixels outside of the mask are invalid
+		Pixel<PixelRgbd> outside = Pixel<PixelRgbd>::Zero();
+		outside.data.normal = Eigen::Vector3f(0.0f, 0.0f, -1.0f);
+		auto regions = detail::MaskedRegionPixels(mask, boxes, outside,
+			[&](unsigned x, unsigned y) {
+				Pixel<PixelRgbd> q;
+				DaspPixel(img_rgb, img_d, cam, opt, x, y, q);
+				return q;
+			},
+			exec);
+		float density_scale_factor = 1.0f;
 		if(opt.num_superpixels > 0) {
-			// compute current total density = number of superpixels
-			float total_density = 0.0f;
-			for(const auto& q : img_data) {
-				total_density += q.density;
+			double total_density = 0.0;
+			for(const auto& region : regions) {
+				for(const auto& q : region.pixels) {
+					total_density += q.density;
+				}
 			}
-			// compute density scale factor
-			float density_scale_factor = static_cast<float>(opt.num_superpixels) / total_density;
-			// scale density
-			for(auto& q : img_data) {
-				q.density *= density_scale_factor;
+			if(total_density > 0.0) {
+				density_scale_factor = static_cast<float>(static_cast<double>(opt.num_superpixels) / total_density);
+				for(auto& region : regions) {
+					for(auto& q : region.pixels) {
+						q.density *= density_scale_factor;
+					}
+				}
 			}
 		}
+		Segmentation<PixelRgbd> seg = detail::MaskedAlic(regions, img_d.width(), img_d.height(),
+			PoissonDiskSamplingMethod::FloydSteinbergExpo,
+			DaspDistance(opt),
+			opt.alic,
+			exec);
+		seg.density_scale = density_scale_factor;
+		return seg;
+	}
 
-		auto sp = ALIC(img_data,
-			ComputeSeeds(PDS_METHOD, img_data),
-			[COMPACTNESS=opt.compactness, NORMAL_WEIGHT=opt.normal_weight, RADIUS_SCL=1.0f/(opt.radius*opt.radius)]
-			(const asp::Superpixel<PixelRgbd>& a, const Pixel<PixelRgbd>& b) {
-				return
-					COMPACTNESS * (a.data.world - b.data.world).squaredNorm() * RADIUS_SCL
-					+ (1.0f - COMPACTNESS) * (
-						(1.0f - NORMAL_WEIGHT) * (a.data.color - b.data.color).squaredNorm()
-						+ NORMAL_WEIGHT * NormalDistance(a.data.normal, b.data.normal)
-					);
-			});
+	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const slimage::Image1ub& mask, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		detail::CheckMaskSize(mask, img_d.width(), img_d.height());
+		return SuperpixelsDaspRegions(img_rgb, img_d, mask, MaskRegions(mask, exec), opt, exec);
+	}
 
-		std::cout << sp.superpixels.size() << " superpixels" << std::endl;
+	Segmentation<PixelRgbd> SuperpixelsDasp(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const std::vector<Roi>& rois, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		const unsigned width = img_d.width();
+		const unsigned height = img_d.height();
+		return SuperpixelsDaspRegions(img_rgb, img_d, RoiMask(width, height, rois), MergeRois(width, height, rois), opt, exec);
+	}
+
+	template Segmentation<PixelRgbdF<RgbdAll>> SuperpixelsDaspF<RgbdAll>(const slimage::Image3ub&, const slimage::Image1ui16&, const DaspParameters&, const ExecutionContext&);
+	template Segmentation<PixelRgbdF<RgbdWorld>> SuperpixelsDaspF<RgbdWorld>(const slimage::Image3ub&, const slimage::Image1ui16&, const DaspParameters&, const ExecutionContext&);
+	template Segmentation<PixelRgbdF<RgbdWorld | RgbdColor>> SuperpixelsDaspF<RgbdWorld | RgbdColor>(const slimage::Image3ub&, const slimage::Image1ui16&, const DaspParameters&, const ExecutionContext&);
+	template Segmentation<PixelRgbdF<RgbdWorld | RgbdNormal>> SuperpixelsDaspF<RgbdWorld | RgbdNormal>(const slimage::Image3ub&, const slimage::Image1ui16&, const DaspParameters&, const ExecutionContext&);
+	template Segmentation<PixelRgbdF<RgbdWorld | RgbdColor | RgbdNormal>> SuperpixelsDaspF<RgbdWorld | RgbdColor | RgbdNormal>(const slimage::Image3ub&, const slimage::Image1ui16&, const DaspParameters&, const ExecutionContext&);
+
+	SurfelFrame DaspClusteringSurfels(const slimage::Image<Pixel<PixelRgbd>,1>& pixels, const std::vector<Seed>& seeds, const DaspParameters& opt, bool with_covariance, const ExecutionContext& exec)
+	{
+		auto moments = MakeMomentFeatures<3>(
+			[](int, int, const Pixel<PixelRgbd>& px) { return px.data.world; });
+		const Segmentation<PixelRgbd> seg = ALIC(pixels, seeds, DaspDistance(opt), opt.alic, exec, moments);
+		SurfelFrame frame;
+		frame.surfels.reserve(seg.superpixels.size());
+		for(size_t i=0; i<seg.superpixels.size(); i++) {
+			if(moments.count[i] == 0.0) {
+				continue;
+			}
+			const auto& sp = seg.superpixels[i];
+			const Eigen::Matrix3f cov = moments.covariance(i);
+			// a disc with radius r has variance r^2/4 along each in-plane axis
+			const float in_plane = cov.trace() - sp.data.normal.dot(cov * sp.data.normal);
+			Surfel s;
+			for(int k=0; k<3; k++) {
+				s.position[k] = sp.data.world[k];
+				s.normal[k] = sp.data.normal[k];
+				s.color[k] = static_cast<unsigned char>(255.0f * std::min(std::max(sp.data.color[k], 0.0f), 1.0f));
+			}
+			s.radius = std::sqrt(2.0f * std::max(in_plane, 0.0f));
+			s.flags = 0;
+			s.num_pixels = static_cast<uint32_t>(moments.count[i]);
+			frame.surfels.push_back(s);
+			if(with_covariance) {
+				frame.covariances.push_back({cov(0,0), cov(0,1), cov(0,2), cov(1,1), cov(1,2), cov(2,2)});
+			}
+		}
+		return frame;
+	}
 
-		return sp;
+	SurfelFrame SuperpixelsDaspSurfels(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const DaspParameters& opt, bool with_covariance, const ExecutionContext& exec)
+	{
+		auto img_data = DaspPixels(img_rgb, img_d, opt, exec);
+		return DaspClusteringSurfels(img_data, DaspSeeds(img_data, exec), opt, with_covariance, exec);
+	}
+
+	SegmentationHierarchy<PixelRgbd> SuperpixelsDaspHierarchy(const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const std::vector<unsigned>& counts, const DaspParameters& opt_in, const ExecutionContext& exec)
+	{
+		// density is rescaled per level
+		DaspParameters opt = opt_in;
+		opt.num_superpixels = 0;
+		auto img_data = DaspPixels(img_rgb, img_d, opt, exec);
+		return ComputeHierarchy(img_data, counts,
+			PoissonDiskSamplingMethod::FloydSteinbergExpo,
+			DaspDistance(opt),
+			opt.alic,
+			exec);
+	}
+
+	slimage::Image1ub DaspChangeMask(const Segmentation<PixelRgbd>& previous, const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const DaspParameters& opt, float color_threshold, float depth_threshold, const ExecutionContext& exec)
+	{
+		const unsigned width = img_d.width();
+		const unsigned height = img_d.height();
+		slimage::Image1ub changed{width, height};
+		const size_t num_bands = exec.numChunks(height);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+			const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+			for(unsigned y=y1; y<y2; y++) {
+				for(unsigned x=0; x<width; x++) {
+					const auto& prev = previous.input(x,y);
+					const auto& rgb = img_rgb(x,y);
+					const Eigen::Vector3f color = Eigen::Vector3f{ static_cast<float>(rgb[0]), static_cast<float>(rgb[1]), static_cast<float>(rgb[2]) }/255.0f;
+					const float depth = static_cast<float>(img_d(x,y)) * opt.depth_to_z;
+					const bool valid = (img_d(x,y) != 0);
+					changed(x,y) = (
+						valid != prev.valid()
+						|| (color - prev.data.color).cwiseAbs().maxCoeff() > color_threshold
+						|| (valid && std::abs(depth - prev.data.depth) > depth_threshold)
+					) ? 1 : 0;
+				}
+			}
+		});
+		return changed;
 	}
 
+	/** Recomputes the DASP pixels close to pixels marked in 'changed'
+	 * Pixel features depend on a small neighbourhood (depth gradient), thus features
+	 * are recomputed for all tiles which contain or touch a changed pixel.
+	 * Densities are scaled with the density scale factor of the previous frame (see Segmentation::density_scale).
+	 */
+	void UpdateDaspPixels(const slimage::Image<Pixel<PixelRgbd>,1>& pixels, const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const slimage::Image1ub& changed, const DaspParameters& opt, float density_scale, const ExecutionContext& exec)
+	{
+		constexpr unsigned TILE = 32;
+		const unsigned width = img_d.width();
+		const unsigned height = img_d.height();
+		const Roi box = MaskBoundingBox(changed, exec);
+		if(box.empty()) {
+			return;
+		}
+		// tiles with changed pixels (tiles are aligned to the image, only the ones overlapping the box are visited)
+		const unsigned tiles_x = (width + TILE - 1) / TILE;
+		const unsigned tiles_y = (height + TILE - 1) / TILE;
+		const unsigned tx1 = box.x / TILE, tx2 = (box.x + box.width - 1) / TILE + 1;
+		const unsigned ty1 = box.y / TILE, ty2 = (box.y + box.height - 1) / TILE + 1;
+		std::vector<unsigned char> tile_changed(tiles_x*tiles_y, 0);
+		exec.parallel_for(ty2 - ty1, [&](size_t i) {
+			const unsigned ty = ty1 + i;
+			for(unsigned y=std::max(ty*TILE, box.y); y<std::min((ty + 1)*TILE, box.y + box.height); y++) {
+				for(unsigned x=box.x; x<box.x + box.width; x++) {
+					if(changed(x,y)) {
+						tile_changed[ty*tiles_x + x/TILE] = 1;
+					}
+				}
+			}
+		});
+		std::vector<std::pair<unsigned,unsigned>> tiles;
+		for(unsigned ty=(ty1 > 0 ? ty1-1 : 0); ty<std::min(ty2+1, tiles_y); ty++) {
+			for(unsigned tx=(tx1 > 0 ? tx1-1 : 0); tx<std::min(tx2+1, tiles_x); tx++) {
+				bool touched = false;
+				for(unsigned ny=(ty > 0 ? ty-1 : 0); ny<std::min(ty+2, tiles_y); ny++) {
+					for(unsigned nx=(tx > 0 ? tx-1 : 0); nx<std::min(tx+2, tiles_x); nx++) {
+						touched = touched || tile_changed[ny*tiles_x + nx];
+					}
+				}
+				if(touched) {
+					tiles.push_back(std::make_pair(tx, ty));
+				}
+			}
+		}
+		const DaspCamera cam(width, height, opt);
+		exec.parallel_for(tiles.size(), [&](size_t i) {
+			const unsigned x1 = tiles[i].first*TILE;
+			const unsigned y1 = tiles[i].second*TILE;
+			for(unsigned y=y1; y<std::min(y1 + TILE, height); y++) {
+				for(unsigned x=x1; x<std::min(x1 + TILE, width); x++) {
+					Pixel<PixelRgbd>& q = pixels(x,y);
+					DaspPixel(img_rgb, img_d, cam, opt, x, y, q);
+					q.density *= density_scale;
+				}
+			}
+		});
+	}
+
+	Segmentation<PixelRgbd> SuperpixelsDaspUpdate(const Segmentation<PixelRgbd>& previous, const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const slimage::Image1ub& changed, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		slimage::Image<Pixel<PixelRgbd>,1> img_data{img_d.width(), img_d.height()};
+		std::copy(previous.input.begin(), previous.input.end(), img_data.begin());
+		UpdateDaspPixels(img_data, img_rgb, img_d, changed, opt, previous.density_scale, exec);
+		return ALICUpdate(previous, img_data, changed, DaspDistance(opt), opt.alic, exec);
+	}
+
+	Segmentation<PixelRgbd> SuperpixelsDaspUpdate(Segmentation<PixelRgbd>&& previous, const slimage::Image3ub& img_rgb, const slimage::Image1ui16& img_d, const slimage::Image1ub& changed, const DaspParameters& opt, const ExecutionContext& exec)
+	{
+		UpdateDaspPixels(previous.input, img_rgb, img_d, changed, opt, previous.density_scale, exec);
+		return ALICUpdate(std::move(previous), changed, DaspDistance(opt), opt.alic, exec);
+	}
 
 }
\ No newline at end of file
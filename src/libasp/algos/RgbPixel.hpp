@@ -0,0 +1,47 @@
+#pragma once
+
+#include <asp/algos.hpp>
+#include <slimage/image.hpp>
+
+namespace asp
+{
+
+namespace detail
+{
+	/** Computes the SLIC and ASP pixel from color and density */
+	inline
+	Pixel<PixelRgb> RgbPixel(unsigned x, unsigned y, const slimage::Pixel3ub& px, float density)
+	{
+		return Pixel<PixelRgb>{
+			1.0f,
+			{
+				static_cast<float>(x),
+				static_cast<float>(y)
+			},
+			density,
+			{
+				Eigen::Vector3f{
+					static_cast<float>(px[0]),
+					static_cast<float>(px[1]),
+					static_cast<float>(px[2])
+				}/255.0f
+			}
+		};
+	}
+
+	/** Computes SLIC and ASP pixels from a color view, density(x,y) gives the density of pixel (x,y) */
+	template<typename D>
+	slimage::Image<Pixel<PixelRgb>,1> RgbPixels(const ColorView& color, D density)
+	{
+		slimage::Image<Pixel<PixelRgb>,1> pixels{color.width, color.height};
+		for(unsigned y=0; y<color.height; y++) {
+			for(unsigned x=0; x<color.width; x++) {
+				const unsigned char* p = color.at(x,y);
+				pixels(x,y) = RgbPixel(x, y, slimage::Pixel3ub{p[0], p[1], p[2]}, density(x,y));
+			}
+		}
+		return pixels;
+	}
+}
+
+}
@@ -1,41 +1,89 @@
 #include <slimage/algorithm.hpp>
 #include <asp/algos.hpp>
 #include <asp/alic.hpp>
+#include "RgbPixel.hpp"
+#include <asp/hierarchy.hpp>
 
 namespace asp
 {
 
-	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& img_rgb, const SlicParameters& opt)
+	/** Computes SLIC pixels with constant density */
+	slimage::Image<Pixel<PixelRgb>,1> SlicPixels(const slimage::Image3ub& img_rgb, float density)
 	{
-		const float density = static_cast<float>(opt.num_superpixels) / (img_rgb.width() * img_rgb.height());
-		auto img_data = slimage::ConvertUV(img_rgb,
+		return slimage::ConvertUV(img_rgb,
 			[density](unsigned x, unsigned y, const slimage::Pixel3ub& px) {
-				return Pixel<PixelRgb>{
-					1.0f,
-					{
-						static_cast<float>(x),
-						static_cast<float>(y)
-					},
-					density,
-					{
-						Eigen::Vector3f{
-							static_cast<float>(px[0]),
-							static_cast<float>(px[1]),
-							static_cast<float>(px[2])
-						}/255.0f
-					}
-				};
+				return detail::RgbPixel(x, y, px, density);
 			});
+	}
 
+	/** SLIC clustering of pixels with constant density */
+	Segmentation<PixelRgb> SlicClustering(const slimage::Image<Pixel<PixelRgb>,1>& img_data, const SlicParameters& opt, const ExecutionContext& exec)
+	{
 		auto sp = ALIC(img_data,
-			ComputeSeeds(PoissonDiskSamplingMethod::Grid, img_data),
-			[COMPACTNESS=opt.compactness](const Superpixel<PixelRgb>& a, const Pixel<PixelRgb>& b) {
-				return COMPACTNESS * (a.position - b.position).squaredNorm() / (a.radius * a.radius)
-					+ (1.0f - COMPACTNESS) * (a.data.color - b.data.color).squaredNorm();
-			});
+			ComputeSeeds(PoissonDiskSamplingMethod::Grid, img_data, exec),
+			PixelRgbDistance{opt.compactness},
+			opt.alic,
+			exec);
 
 		return sp;
 	}
 
+	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& img_rgb, const SlicParameters& opt, const ExecutionContext& exec)
+	{
+		const float density = static_cast<float>(opt.num_superpixels) / (img_rgb.width() * img_rgb.height());
+		return SlicClustering(SlicPixels(img_rgb, density), opt, exec);
+	}
+
+	Segmentation<PixelRgb> SuperpixelsSlic(const ColorView& color, const SlicParameters& opt, const ExecutionContext& exec)
+	{
+		const float density = static_cast<float>(opt.num_superpixels) / (color.width * color.height);
+		return SlicClustering(
+			detail::RgbPixels(color, [density](unsigned, unsigned) { return density; }),
+			opt, exec);
+	}
+
+	/** SLIC superpixels for the mask pixels in the given boxes which must not overlap */
+	Segmentation<PixelRgb> SuperpixelsSlicRegions(const slimage::Image3ub& img_rgb, const slimage::Image1ub& mask, const std::vector<Roi>& boxes, const SlicParameters& opt, const ExecutionContext& exec)
+	{
+		const float density = static_cast<float>(opt.num_superpixels) / (img_rgb.width() * img_rgb.height());
+		// pixels outside of the mask keep the density such that the seed grid has the same spacing as for the full image
+		Pixel<PixelRgb> outside = Pixel<PixelRgb>::Zero();
+		outside.density = density;
+		const auto regions = detail::MaskedRegionPixels(mask, boxes, outside,
+			[&img_rgb,density](unsigned x, unsigned y) {
+				return detail::RgbPixel(x, y, img_rgb(x,y), density);
+			},
+			exec);
+		return detail::MaskedAlic(regions, img_rgb.width(), img_rgb.height(),
+			PoissonDiskSamplingMethod::Grid,
+			PixelRgbDistance{opt.compactness},
+			opt.alic,
+			exec);
+	}
+
+	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& img_rgb, const slimage::Image1ub& mask, const SlicParameters& opt, const ExecutionContext& exec)
+	{
+		detail::CheckMaskSize(mask, img_rgb.width(), img_rgb.height());
+		return SuperpixelsSlicRegions(img_rgb, mask, MaskRegions(mask, exec), opt, exec);
+	}
+
+	Segmentation<PixelRgb> SuperpixelsSlic(const slimage::Image3ub& img_rgb, const std::vector<Roi>& rois, const SlicParameters& opt, const ExecutionContext& exec)
+	{
+		const unsigned width = img_rgb.width();
+		const unsigned height = img_rgb.height();
+		return SuperpixelsSlicRegions(img_rgb, RoiMask(width, height, rois), MergeRois(width, height, rois), opt, exec);
+	}
+
+	SegmentationHierarchy<PixelRgb> SuperpixelsSlicHierarchy(const slimage::Image3ub& img_rgb, const std::vector<unsigned>& counts, const SlicParameters& opt, const ExecutionContext& exec)
+	{
+		// density is rescaled per level
+		auto img_data = SlicPixels(img_rgb, 1.0f);
+		return ComputeHierarchy(img_data, counts,
+			PoissonDiskSamplingMethod::Grid,
+			PixelRgbDistance{opt.compactness},
+			opt.alic,
+			exec);
+	}
+
 
-}
\ No newline at end of file
+}
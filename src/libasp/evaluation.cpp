@@ -0,0 +1,302 @@
+#include <asp/evaluation.hpp>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+namespace asp
+{
+
+	namespace
+	{
+		void CheckDimensions(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth)
+		{
+			if(labels.width() != ground_truth.width() || labels.height() != ground_truth.height()) {
+				throw std::runtime_error("Evaluation: superpixel and ground truth images must have the same size");
+			}
+		}
+
+		/** Number of pixels for each pair of superpixel and ground truth label */
+		struct LabelPairHistogram
+		{
+			// key is superpixel label in the upper and ground truth label in the lower 32 bits
+			std::unordered_map<uint64_t,size_t> counts;
+
+			// largest superpixel label
+			int max_label = -1;
+
+			// number of pixels with valid labels
+			size_t num_pixels = 0;
+
+			static uint64_t Key(int s, int g)
+			{ return (static_cast<uint64_t>(s) << 32) | static_cast<uint32_t>(g); }
+
+			static int SuperpixelLabel(uint64_t key)
+			{ return static_cast<int>(key >> 32); }
+		};
+
+		/** Computes the label pair histogram with one histogram per image band */
+		LabelPairHistogram ComputeLabelPairHistogram(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth, const ExecutionContext& exec)
+		{
+			CheckDimensions(labels, ground_truth);
+			const size_t num_bands = exec.numChunks(labels.height());
+			std::vector<LabelPairHistogram> band_hist(num_bands);
+			exec.parallel_for(num_bands, [&](size_t band) {
+				LabelPairHistogram& h = band_hist[band];
+				const size_t i1 = detail::ChunkBegin(labels.height(), num_bands, band) * labels.width();
+				const size_t i2 = detail::ChunkBegin(labels.height(), num_bands, band + 1) * labels.width();
+				// consecutive pixels mostly have the same label pair
+				uint64_t last_key = 0;
+				size_t last_count = 0;
+				for(size_t i=i1; i<i2; i++) {
+					const int s = labels[i];
+					const int g = ground_truth[i];
+					if(s < 0 || g < 0) {
+						continue;
+					}
+					const uint64_t key = LabelPairHistogram::Key(s, g);
+					if(key != last_key && last_count > 0) {
+						h.counts[last_key] += last_count;
+						last_count = 0;
+					}
+					last_key = key;
+					last_count++;
+					h.max_label = std::max(h.max_label, s);
+					h.num_pixels++;
+				}
+				if(last_count > 0) {
+					h.counts[last_key] += last_count;
+				}
+			});
+			LabelPairHistogram result = std::move(band_hist.front());
+			for(size_t band=1; band<num_bands; band++) {
+				const LabelPairHistogram& h = band_hist[band];
+				for(const auto& q : h.counts) {
+					result.counts[q.first] += q.second;
+				}
+				result.max_label = std::max(result.max_label, h.max_label);
+				result.num_pixels += h.num_pixels;
+			}
+			return result;
+		}
+
+		/** Number of pixels of each superpixel */
+		std::vector<size_t> SuperpixelSizes(const LabelPairHistogram& hist)
+		{
+			std::vector<size_t> sizes(hist.max_label + 1, 0);
+			for(const auto& q : hist.counts) {
+				sizes[LabelPairHistogram::SuperpixelLabel(q.first)] += q.second;
+			}
+			return sizes;
+		}
+
+		float UndersegmentationError(const LabelPairHistogram& hist)
+		{
+			if(hist.num_pixels == 0) {
+				return 0.0f;
+			}
+			const std::vector<size_t> sizes = SuperpixelSizes(hist);
+			size_t leakage = 0;
+			for(const auto& q : hist.counts) {
+				const size_t size = sizes[LabelPairHistogram::SuperpixelLabel(q.first)];
+				leakage += std::min(q.second, size - q.second);
+			}
+			return static_cast<float>(static_cast<double>(leakage) / static_cast<double>(hist.num_pixels));
+		}
+
+		float AchievableSegmentationAccuracy(const LabelPairHistogram& hist)
+		{
+			if(hist.num_pixels == 0) {
+				return 1.0f;
+			}
+			std::vector<size_t> best(hist.max_label + 1, 0);
+			for(const auto& q : hist.counts) {
+				size_t& b = best[LabelPairHistogram::SuperpixelLabel(q.first)];
+				b = std::max(b, q.second);
+			}
+			size_t correct = 0;
+			for(size_t b : best) {
+				correct += b;
+			}
+			return static_cast<float>(static_cast<double>(correct) / static_cast<double>(hist.num_pixels));
+		}
+
+		/** Marks pixels whose right or bottom neighbour has a different label */
+		std::vector<unsigned char> BoundaryMap(const slimage::Image<int,1>& labels, bool ignore_negative, const ExecutionContext& exec)
+		{
+			const int width = labels.width();
+			const int height = labels.height();
+			std::vector<unsigned char> boundary(labels.size(), 0);
+			const size_t num_bands = exec.numChunks(height);
+			exec.parallel_for(num_bands, [&](size_t band) {
+				const int y1 = detail::ChunkBegin(height, num_bands, band);
+				const int y2 = detail::ChunkBegin(height, num_bands, band + 1);
+				for(int y=y1; y<y2; y++) {
+					for(int x=0; x<width; x++) {
+						const int l = labels(x,y);
+						if(ignore_negative && l < 0) {
+							continue;
+						}
+						const bool right = (x+1 < width) && labels(x+1,y) != l && !(ignore_negative && labels(x+1,y) < 0);
+						const bool bottom = (y+1 < height) && labels(x,y+1) != l && !(ignore_negative && labels(x,y+1) < 0);
+						boundary[y*width + x] = (right || bottom) ? 1 : 0;
+					}
+				}
+			});
+			return boundary;
+		}
+
+		/** Dilates a binary map with a square of size 2*r+1 using running sums along rows and columns */
+		std::vector<unsigned char> Dilate(const std::vector<unsigned char>& map, int width, int height, int r, const ExecutionContext& exec)
+		{
+			std::vector<unsigned char> rows(map.size(), 0);
+			const size_t num_row_chunks = exec.numChunks(height);
+			exec.parallel_for(num_row_chunks, [&](size_t chunk) {
+				const int y1 = detail::ChunkBegin(height, num_row_chunks, chunk);
+				const int y2 = detail::ChunkBegin(height, num_row_chunks, chunk + 1);
+				for(int y=y1; y<y2; y++) {
+					const unsigned char* src = map.data() + y*width;
+					unsigned char* dst = rows.data() + y*width;
+					// number of set pixels in the window [x-r,x+r]
+					int count = 0;
+					for(int x=0; x<std::min(r, width); x++) {
+						count += src[x];
+					}
+					for(int x=0; x<width; x++) {
+						if(x + r < width) {
+							count += src[x + r];
+						}
+						if(x - r - 1 >= 0) {
+							count -= src[x - r - 1];
+						}
+						dst[x] = (count > 0) ? 1 : 0;
+					}
+				}
+			});
+			std::vector<unsigned char> result(map.size(), 0);
+			const size_t num_col_chunks = exec.numChunks(width);
+			exec.parallel_for(num_col_chunks, [&](size_t chunk) {
+				const int x1 = detail::ChunkBegin(width, num_col_chunks, chunk);
+				const int x2 = detail::ChunkBegin(width, num_col_chunks, chunk + 1);
+				// process all columns of the chunk row by row for sequential memory access
+				std::vector<int> count(x2 - x1, 0);
+				for(int y=0; y<std::min(r, height); y++) {
+					for(int x=x1; x<x2; x++) {
+						count[x - x1] += rows[y*width + x];
+					}
+				}
+				for(int y=0; y<height; y++) {
+					for(int x=x1; x<x2; x++) {
+						int& c = count[x - x1];
+						if(y + r < height) {
+							c += rows[(y + r)*width + x];
+						}
+						if(y - r - 1 >= 0) {
+							c -= rows[(y - r - 1)*width + x];
+						}
+						result[y*width + x] = (c > 0) ? 1 : 0;
+					}
+				}
+			});
+			return result;
+		}
+	}
+
+	float BoundaryRecall(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth, unsigned tolerance, const ExecutionContext& exec)
+	{
+		CheckDimensions(labels, ground_truth);
+		const int width = labels.width();
+		const int height = labels.height();
+		const std::vector<unsigned char> sp_boundary = Dilate(BoundaryMap(labels, false, exec), width, height, tolerance, exec);
+		const std::vector<unsigned char> gt_boundary = BoundaryMap(ground_truth, true, exec);
+		size_t num_boundary = 0;
+		size_t num_recalled = 0;
+		for(size_t i=0; i<gt_boundary.size(); i++) {
+			if(gt_boundary[i]) {
+				num_boundary++;
+				num_recalled += sp_boundary[i];
+			}
+		}
+		return (num_boundary > 0) ? static_cast<float>(static_cast<double>(num_recalled) / static_cast<double>(num_boundary)) : 1.0f;
+	}
+
+	float UndersegmentationError(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth, const ExecutionContext& exec)
+	{
+		return UndersegmentationError(ComputeLabelPairHistogram(labels, ground_truth, exec));
+	}
+
+	float AchievableSegmentationAccuracy(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth, const ExecutionContext& exec)
+	{
+		return AchievableSegmentationAccuracy(ComputeLabelPairHistogram(labels, ground_truth, exec));
+	}
+
+	float Compactness(const slimage::Image<int,1>& labels, const ExecutionContext& exec)
+	{
+		const int width = labels.width();
+		const int height = labels.height();
+		int max_label = -1;
+		for(int l : labels) {
+			max_label = std::max(max_label, l);
+		}
+		const size_t num_labels = max_label + 1;
+		// area and perimeter (number of pixel edges to other labels or the image border) per band
+		const size_t num_bands = exec.numChunks(height);
+		std::vector<std::vector<size_t>> band_area(num_bands);
+		std::vector<std::vector<size_t>> band_perimeter(num_bands);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			auto& area = band_area[band];
+			auto& perimeter = band_perimeter[band];
+			area.resize(num_labels, 0);
+			perimeter.resize(num_labels, 0);
+			const int y1 = detail::ChunkBegin(height, num_bands, band);
+			const int y2 = detail::ChunkBegin(height, num_bands, band + 1);
+			for(int y=y1; y<y2; y++) {
+				for(int x=0; x<width; x++) {
+					const int l = labels(x,y);
+					if(l < 0) {
+						continue;
+					}
+					area[l]++;
+					perimeter[l] +=
+						  ((x == 0 || labels(x-1,y) != l) ? 1 : 0)
+						+ ((x+1 == width || labels(x+1,y) != l) ? 1 : 0)
+						+ ((y == 0 || labels(x,y-1) != l) ? 1 : 0)
+						+ ((y+1 == height || labels(x,y+1) != l) ? 1 : 0);
+				}
+			}
+		});
+		double total_area = 0.0;
+		double weighted_quotient = 0.0;
+		for(size_t l=0; l<num_labels; l++) {
+			size_t area = 0;
+			size_t perimeter = 0;
+			for(size_t band=0; band<num_bands; band++) {
+				area += band_area[band][l];
+				perimeter += band_perimeter[band][l];
+			}
+			if(area == 0) {
+				continue;
+			}
+			const double a = static_cast<double>(area);
+			const double p = static_cast<double>(perimeter);
+			total_area += a;
+			weighted_quotient += a * 4.0 * 3.14159265358979 * a / (p * p);
+		}
+		return (total_area > 0.0) ? static_cast<float>(weighted_quotient / total_area) : 0.0f;
+	}
+
+	EvaluationResult Evaluate(const slimage::Image<int,1>& labels, const slimage::Image<int,1>& ground_truth, const EvaluationParameters& opt, const ExecutionContext& exec)
+	{
+		const LabelPairHistogram hist = ComputeLabelPairHistogram(labels, ground_truth, exec);
+		EvaluationResult result;
+		result.boundary_recall = BoundaryRecall(labels, ground_truth, opt.boundary_tolerance, exec);
+		result.undersegmentation_error = UndersegmentationError(hist);
+		result.achievable_segmentation_accuracy = AchievableSegmentationAccuracy(hist);
+		result.compactness = Compactness(labels, exec);
+		const std::vector<size_t> sizes = SuperpixelSizes(hist);
+		result.num_superpixels = std::count_if(sizes.begin(), sizes.end(), [](size_t n) { return n > 0; });
+		return result;
+	}
+
+}
@@ -0,0 +1,177 @@
+#include <asp/execution.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+
+namespace asp
+{
+
+	struct ExecutionContext::Impl
+	{
+		unsigned concurrency;
+
+		// executor of the caller (empty if the pool is owned)
+		Executor executor;
+
+		// owned thread pool
+		std::deque<std::function<void()>> queue;
+		boost::mutex mutex;
+		boost::condition_variable cond;
+		bool stop = false;
+		boost::thread_group threads;
+
+		~Impl()
+		{
+			{
+				boost::lock_guard<boost::mutex> lock(mutex);
+				stop = true;
+			}
+			cond.notify_all();
+			threads.join_all();
+		}
+
+		void post(std::function<void()> task)
+		{
+			if(executor) {
+				executor(std::move(task));
+				return;
+			}
+			{
+				boost::lock_guard<boost::mutex> lock(mutex);
+				queue.push_back(std::move(task));
+			}
+			cond.notify_one();
+		}
+
+		void work()
+		{
+			while(true) {
+				std::function<void()> task;
+				{
+					boost::unique_lock<boost::mutex> lock(mutex);
+					while(!stop && queue.empty()) {
+						cond.wait(lock);
+					}
+					if(queue.empty()) {
+						return;
+					}
+					task = std::move(queue.front());
+					queue.pop_front();
+				}
+				task();
+			}
+		}
+	};
+
+	namespace
+	{
+		/** Shared state of one parallel loop (kept alive by helper tasks which start late) */
+		struct LoopState
+		{
+			size_t n;
+			std::function<void(size_t)> f;
+			std::atomic<size_t> next;
+			std::atomic<size_t> done;
+			std::atomic<bool> failed;
+			std::exception_ptr error; // first exception thrown by f (guarded by mutex)
+			boost::mutex mutex;
+			boost::condition_variable cond;
+
+			LoopState(size_t n, const std::function<void(size_t)>& f)
+			:	n(n), f(f), next(0), done(0), failed(false)
+			{}
+
+			void run()
+			{
+				size_t count = 0;
+				for(size_t i=next++; i<n; i=next++) {
+					// after a failure the remaining iterations are only claimed and counted
+					if(!failed) {
+						try {
+							f(i);
+						}
+						catch(...) {
+							boost::lock_guard<boost::mutex> lock(mutex);
+							if(!error) {
+								error = std::current_exception();
+							}
+							failed = true;
+						}
+					}
+					count++;
+				}
+				if(count > 0 && (done += count) == n) {
+					boost::lock_guard<boost::mutex> lock(mutex);
+					cond.notify_all();
+				}
+			}
+
+			void wait()
+			{
+				boost::unique_lock<boost::mutex> lock(mutex);
+				while(done < n) {
+					cond.wait(lock);
+				}
+				if(error) {
+					std::rethrow_exception(error);
+				}
+			}
+		};
+	}
+
+	const ExecutionContext& ExecutionContext::Serial()
+	{
+		static const ExecutionContext serial(1);
+		return serial;
+	}
+
+	ExecutionContext::ExecutionContext(unsigned num_threads)
+	:	impl_(std::make_shared<Impl>())
+	{
+		if(num_threads == 0) {
+			num_threads = std::max(boost::thread::hardware_concurrency(), 1u);
+		}
+		impl_->concurrency = num_threads;
+		// the calling thread participates in each loop, so one thread less is needed
+		for(unsigned i=1; i<num_threads; i++) {
+			Impl* impl = impl_.get();
+			impl_->threads.create_thread([impl]() { impl->work(); });
+		}
+	}
+
+	ExecutionContext::ExecutionContext(Executor executor, unsigned concurrency)
+	:	impl_(std::make_shared<Impl>())
+	{
+		impl_->concurrency = std::max(concurrency, 1u);
+		impl_->executor = executor;
+	}
+
+	unsigned ExecutionContext::concurrency() const
+	{ return impl_->concurrency; }
+
+	size_t ExecutionContext::numChunks(size_t n) const
+	{
+		// chunks of at least 32 items (e.g. image rows) and at most 64 chunks
+		return std::max<size_t>(std::min<size_t>((n + 31) / 32, 64), 1);
+	}
+
+	void ExecutionContext::parallel_for(size_t n, const std::function<void(size_t)>& f) const
+	{
+		if(serial() || n <= 1) {
+			for(size_t i=0; i<n; i++) {
+				f(i);
+			}
+			return;
+		}
+		auto state = std::make_shared<LoopState>(n, f);
+		const size_t num_helpers = std::min<size_t>(concurrency() - 1, n - 1);
+		for(size_t i=0; i<num_helpers; i++) {
+			impl_->post([state]() { state->run(); });
+		}
+		state->run();
+		state->wait();
+	}
+
+}
@@ -0,0 +1,87 @@
+#include <asp/isa.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+namespace asp
+{
+
+	namespace
+	{
+		Isa DetectIsaImpl()
+		{
+#if ASP_ISA_DISPATCH
+			// checks CPUID and that the operating system saves the extended registers
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+				&& __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")
+				&& __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2")) {
+				return Isa::Avx512;
+			}
+			if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2")) {
+				return Isa::Avx2;
+			}
+			if(__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+				return Isa::Sse42;
+			}
+#endif
+			return Isa::Baseline;
+		}
+
+		/** Instruction set selected by the environment variable ASP_ISA (Avx512 if not set or unknown) */
+		Isa EnvironmentIsa()
+		{
+			const char* value = std::getenv("ASP_ISA");
+			if(value) {
+				for(Isa isa : {Isa::Baseline, Isa::Sse42, Isa::Avx2, Isa::Avx512}) {
+					if(std::strcmp(value, IsaName(isa)) == 0) {
+						return isa;
+					}
+				}
+			}
+			return Isa::Avx512;
+		}
+
+		Isa Clamp(Isa isa)
+		{
+			const Isa detected = DetectIsa();
+			return (static_cast<int>(isa) < static_cast<int>(detected)) ? isa : detected;
+		}
+
+		std::atomic<int>& ActiveIsaStorage()
+		{
+			static std::atomic<int> active(static_cast<int>(Clamp(EnvironmentIsa())));
+			return active;
+		}
+	}
+
+	const char* IsaName(Isa isa)
+	{
+		switch(isa) {
+		case Isa::Sse42: return "sse4.2";
+		case Isa::Avx2: return "avx2";
+		case Isa::Avx512: return "avx512";
+		default: return "baseline";
+		}
+	}
+
+	Isa DetectIsa()
+	{
+		static const Isa detected = DetectIsaImpl();
+		return detected;
+	}
+
+	Isa ActiveIsa()
+	{
+		return static_cast<Isa>(ActiveIsaStorage().load(std::memory_order_relaxed));
+	}
+
+	Isa SetActiveIsa(Isa isa)
+	{
+		const Isa active = Clamp(isa);
+		ActiveIsaStorage().store(static_cast<int>(active), std::memory_order_relaxed);
+		return active;
+	}
+
+}
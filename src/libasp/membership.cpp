@@ -0,0 +1,114 @@
+#include <asp/membership.hpp>
+
+namespace asp
+{
+
+	namespace
+	{
+		/** Calls f(label, x1, x2) for each run of equal non-negative labels in row y */
+		template<typename F>
+		void ForEachLabelRun(const slimage::Image<int,1>& indices, unsigned y, F f)
+		{
+			const unsigned width = indices.width();
+			unsigned x = 0;
+			while(x < width) {
+				const int label = indices(x,y);
+				const unsigned x1 = x;
+				while(x < width && indices(x,y) == label) {
+					x++;
+				}
+				if(label >= 0) {
+					f(label, x1, x);
+				}
+			}
+		}
+
+		/** Counting sort of the items of all bands into superpixel buckets
+		 * count(band, counts) adds the number of items per superpixel of a band,
+		 * scatter(band, next) writes items of a band to items[next[label]++].
+		 * Returns the offset of each bucket in items.
+		 */
+		template<typename Item, typename Count, typename Scatter>
+		std::vector<unsigned> CountingSort(size_t num_superpixels, size_t num_bands, std::vector<Item>& items, Count count, Scatter scatter, const ExecutionContext& exec)
+		{
+			std::vector<std::vector<unsigned>> band_next(num_bands);
+			exec.parallel_for(num_bands, [&](size_t band) {
+				band_next[band].resize(num_superpixels, 0);
+				count(band, band_next[band]);
+			});
+			// offsets of superpixels and start of each band within a superpixel
+			std::vector<unsigned> offsets(num_superpixels + 1, 0);
+			unsigned total = 0;
+			for(size_t i=0; i<num_superpixels; i++) {
+				offsets[i] = total;
+				for(size_t band=0; band<num_bands; band++) {
+					const unsigned n = band_next[band][i];
+					band_next[band][i] = total;
+					total += n;
+				}
+			}
+			offsets[num_superpixels] = total;
+			items.resize(total);
+			exec.parallel_for(num_bands, [&](size_t band) {
+				scatter(band, band_next[band]);
+			});
+			return offsets;
+		}
+	}
+
+	SuperpixelMembership ComputeMembership(const slimage::Image<int,1>& indices, size_t num_superpixels, MembershipIndex mode, const ExecutionContext& exec)
+	{
+		SuperpixelMembership m;
+		const unsigned width = indices.width();
+		const unsigned height = indices.height();
+		const size_t num_bands = exec.numChunks(height);
+		if(mode == MembershipIndex::Pixels) {
+			m.offsets = CountingSort(num_superpixels, num_bands, m.pixels,
+				[&](size_t band, std::vector<unsigned>& counts) {
+					const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+					const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+					for(unsigned i=y1*width; i<y2*width; i++) {
+						const int label = indices[i];
+						if(label >= 0) {
+							counts[label]++;
+						}
+					}
+				},
+				[&](size_t band, std::vector<unsigned>& next) {
+					const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+					const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+					for(unsigned i=y1*width; i<y2*width; i++) {
+						const int label = indices[i];
+						if(label >= 0) {
+							m.pixels[next[label]++] = i;
+						}
+					}
+				},
+				exec);
+		}
+		if(mode == MembershipIndex::Runs) {
+			m.run_offsets = CountingSort(num_superpixels, num_bands, m.runs,
+				[&](size_t band, std::vector<unsigned>& counts) {
+					const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+					const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+					for(unsigned y=y1; y<y2; y++) {
+						ForEachLabelRun(indices, y, [&](int label, unsigned, unsigned) {
+							counts[label]++;
+						});
+					}
+				},
+				[&](size_t band, std::vector<unsigned>& next) {
+					const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+					const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+					for(unsigned y=y1; y<y2; y++) {
+						ForEachLabelRun(indices, y, [&](int label, unsigned x1, unsigned x2) {
+							m.runs[next[label]++] = PixelRun{y, x1, x2};
+						});
+					}
+				},
+				exec);
+		}
+		return m;
+	}
+
+}
@@ -1,139 +1,219 @@
+#include "PdsRows.hpp"
 #include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 namespace asp
 {
 
-std::vector<Eigen::Vector2f> PdsFloydSteinberg(const Eigen::MatrixXf& density_inp)
+namespace
 {
-	Eigen::MatrixXf density = density_inp;
-	std::vector<Eigen::Vector2f> seeds;
-	for(unsigned int y=0; y<density.cols() - 1; y++) {
-		density(1,y) += density(0,y);
-		for(unsigned int x=1; x<density.rows() - 1; x++) {
-			float v = density(x,y);
+
+/** Floyd-Steinberg error diffusion
+ * A row is sampled when the next row is available (the error diffuses into it),
+ * the last row of the image is not sampled.
+ */
+class FloydSteinbergRows : public detail::PdsRows
+{
+public:
+	FloydSteinbergRows(unsigned width, unsigned height)
+	:	width_(width), height_(height), y_(0), has_current_(false)
+	{}
+
+	void add(unsigned y_begin, const Eigen::MatrixXf& density, std::vector<Eigen::Vector2f>& seeds) override
+	{
+		for(unsigned j=0; j<density.cols(); j++) {
+			const float* row = &density(0,j);
+			if(!has_current_) {
+				current_.assign(row, row + width_);
+				y_ = y_begin + j;
+				has_current_ = true;
+				continue;
+			}
+			std::vector<float> next(row, row + width_);
+			diffuse(next, seeds);
+			current_.swap(next);
+			y_++;
+		}
+	}
+
+private:
+	/** Samples the current row and diffuses its error into the next row */
+	void diffuse(std::vector<float>& next, std::vector<Eigen::Vector2f>& seeds)
+	{
+		if(width_ < 2 || y_ + 1 >= height_) {
+			return;
+		}
+		std::vector<float>& density = current_;
+		density[1] += density[0];
+		for(unsigned int x=1; x<width_ - 1; x++) {
+			float v = density[x];
 			if(v >= 0.5f) {
 				v -= 1.0f;
 				seeds.push_back(
 					Eigen::Vector2f{
 						static_cast<float>(x) + 0.5f,
-						static_cast<float>(y) + 0.5f
+						static_cast<float>(y_) + 0.5f
 					});
 			}
-			density(x+1,y  ) += 7.0f / 16.0f * v;
-			density(x-1,y+1) += 3.0f / 16.0f * v;
-			density(x  ,y+1) += 5.0f / 16.0f * v;
-			density(x+1,y+1) += 1.0f / 16.0f * v;
+			density[x+1] += 7.0f / 16.0f * v;
+			next[x-1] += 3.0f / 16.0f * v;
+			next[x  ] += 5.0f / 16.0f * v;
+			next[x+1] += 1.0f / 16.0f * v;
 		}
 		// carry over
-		density(0, y+1) += density(density.rows()-1, y);
+		next[0] += density[width_-1];
 	}
-	return seeds;
-}
+
+	unsigned width_, height_;
+	unsigned y_; // image row of current_
+	bool has_current_;
+	std::vector<float> current_; // density of row y_ including the diffused error
+};
 
 // Variante von Floyd-Steinberg. Vorteil: Keine Schlangenlinien in dünn besetzten Bereichen.
-std::vector<Eigen::Vector2f> PdsFloydSteinbergExpo(const Eigen::MatrixXf& density)
+class FloydSteinbergExpoRows : public detail::PdsRows
 {
-	// Fehler der nächsten 8 Zeilen in Ringpuffer speichern
-	Eigen::MatrixXf ringbuffer( 16 + density.rows(), 8 );
-	ringbuffer.fill( {0.0f} );
-
-	// Eine schnelle Zufallszahl
-	unsigned int crc32 = 0xffffffff;
+public:
+	explicit FloydSteinbergExpoRows(unsigned width)
+	:	width_(width),
+		// Fehler der nächsten 8 Zeilen in Ringpuffer speichern
+		ringbuffer( 16 + width, 8 ),
+		// Eine schnelle Zufallszahl
+		crc32( 0xffffffff )
+	{
+		ringbuffer.fill( {0.0f} );
+	}
 
-	// Bild abtasten
-	std::vector<Eigen::Vector2f> seeds;
-	for(unsigned int y=0; y < density.cols(); y++)
+	void add(unsigned y_begin, const Eigen::MatrixXf& density, std::vector<Eigen::Vector2f>& seeds) override
 	{
-		float *pRingBuf = &ringbuffer( 8, y % 8 );
-		unsigned int x = 0;
-		while( x < density.rows() )
+		// Bild abtasten
+		for(unsigned int j=0; j < density.cols(); j++)
 		{
-			// Dichte an dieser Koordinate
-			const float v = density(x,y);
-
-			// Zielwert einschließlich diffundiertem Fehler
-			float err = v + pRingBuf[ x ];
-			if( err >= 0.5f) {
-				err-= 1.0f;
-				seeds.push_back(
-					Eigen::Vector2f{
-						static_cast<float>(x) + 0.5f,
-						static_cast<float>(y) + 0.5f
-					});
-			}
-
-			// Diffundierten Fehler aus dem Ringpuffer löschen,
-			// damit die Speicherstelle bei einem erneuten Durchlauf durch den Ringpuffer leer ist.
-			pRingBuf[ x ] = 0.0f;
-
-			// Bei Dichte über  7% den Fehler über Radius 1 diffundieren.
-			// Bei Dichte unter 7% den Fehler über Radius 2 diffundieren.
-			// Bei Dichte unter 4% den Fehler über Radius 4 diffundieren.
-			// Bei Dichte unter 1% den Fehler über Radius 8 diffundieren.
-			const unsigned int LogTable[ 7 ] = { 3, 2, 2, 2, 1, 1, 1 };
-			const int t = static_cast< int >( 100.0 * fabs( v ) );
-			const unsigned int RadiusLog2 = t >= 7 ? 0 : ( t < 1 ? 3 : LogTable[ t ] );
-			const unsigned int radius = 1 << RadiusLog2;
-
-			// Dafür sorgen daß die Fehler aller Punkte innerhalb des Radius auf die
-			// gleiche Koordinate diffundieren. Sonst akkumuliert sich der Fehler nie.
-			// => Ausrichtung auf ein Vielfaches des Radius
-			const int DiffusionX = ( x >> RadiusLog2 ) << RadiusLog2;
-			const int DiffusionY = ( y >> RadiusLog2 ) << RadiusLog2;
-
-			// Die nächsten Pixel innerhalb des Radius schneller durchlaufen.
-			// Annahme: Die Dichte bleibt konstant, sodaß der Radius nicht geändert werden muß.
-			// Dann können alle Fehler auf die gleichen Koordinaten diffundieren.
-			++x;
-			if( v > 0.5f )
+			const unsigned int y = y_begin + j;
+			const float* row = &density( 0, j );
+			float *pRingBuf = &ringbuffer( 8, y % 8 );
+			unsigned int x = 0;
+			while( x < width_ )
 			{
-				// Überspringen in dichten Bereichen: Seed-Punkte erzeugen
-				while( x < DiffusionX + radius )
-				{
-					// Fehler der übersprungenen Pixel mitnehmen.
-					err += density( x, y ) + pRingBuf[ x ] - 1.0f;
+				// Dichte an dieser Koordinate
+				const float v = row[ x ];
+
+				// Zielwert einschließlich diffundiertem Fehler
+				float err = v + pRingBuf[ x ];
+				if( err >= 0.5f) {
+					err-= 1.0f;
 					seeds.push_back(
 						Eigen::Vector2f{
 							static_cast<float>(x) + 0.5f,
 							static_cast<float>(y) + 0.5f
 						});
-					pRingBuf[ x ] = 0;
-					++x;
 				}
-			}
-			else
-			{
-				// Überspringen in spärlichen Gebieten
-				while( x < DiffusionX + radius )
+
+				// Diffundierten Fehler aus dem Ringpuffer löschen,
+				// damit die Speicherstelle bei einem erneuten Durchlauf durch den Ringpuffer leer ist.
+				pRingBuf[ x ] = 0.0f;
+
+				// Bei Dichte über  7% den Fehler über Radius 1 diffundieren.
+				// Bei Dichte unter 7% den Fehler über Radius 2 diffundieren.
+				// Bei Dichte unter 4% den Fehler über Radius 4 diffundieren.
+				// Bei Dichte unter 1% den Fehler über Radius 8 diffundieren.
+				const unsigned int LogTable[ 7 ] = { 3, 2, 2, 2, 1, 1, 1 };
+				const int t = static_cast< int >( 100.0 * fabs( v ) );
+				const unsigned int RadiusLog2 = t >= 7 ? 0 : ( t < 1 ? 3 : LogTable[ t ] );
+				const unsigned int radius = 1 << RadiusLog2;
+
+				// Dafür sorgen daß die Fehler aller Punkte innerhalb des Radius auf die
+				// gleiche Koordinate diffundieren. Sonst akkumuliert sich der Fehler nie.
+				// => Ausrichtung auf ein Vielfaches des Radius
+				const int DiffusionX = ( x >> RadiusLog2 ) << RadiusLog2;
+				const int DiffusionY = ( y >> RadiusLog2 ) << RadiusLog2;
+
+				// Die nächsten Pixel innerhalb des Radius schneller durchlaufen.
+				// Annahme: Die Dichte bleibt konstant, sodaß der Radius nicht geändert werden muß.
+				// Dann können alle Fehler auf die gleichen Koordinaten diffundieren.
+				// (nicht über das Zeilenende hinaus)
+				const unsigned int SkipEnd = std::min( DiffusionX + radius, width_ );
+				++x;
+				if( v > 0.5f )
 				{
-					// Fehler der übersprungenen Pixel mitnehmen.
-					err += density( x, y ) + pRingBuf[ x ];
-					pRingBuf[ x ] = 0;
-					++x;
+					// Überspringen in dichten Bereichen: Seed-Punkte erzeugen
+					while( x < SkipEnd )
+					{
+						// Fehler der übersprungenen Pixel mitnehmen.
+						err += row[ x ] + pRingBuf[ x ] - 1.0f;
+						seeds.push_back(
+							Eigen::Vector2f{
+								static_cast<float>(x) + 0.5f,
+								static_cast<float>(y) + 0.5f
+							});
+						pRingBuf[ x ] = 0;
+						++x;
+					}
+				}
+				else
+				{
+					// Überspringen in spärlichen Gebieten
+					while( x < SkipEnd )
+					{
+						// Fehler der übersprungenen Pixel mitnehmen.
+						err += row[ x ] + pRingBuf[ x ];
+						pRingBuf[ x ] = 0;
+						++x;
+					}
 				}
-			}
 
-			// Zufällig in die eine oder andere Richtung diffundieren,
-			// um Spuren zu verwischen.
-			if( ( crc32 ^ radius ) & 1 )
-			{
-				ringbuffer( 8 + DiffusionX + radius, ( DiffusionY          ) % 8 ) += 7.0f / 16.0f * err;
-				ringbuffer( 8 + DiffusionX - radius, ( DiffusionY + radius ) % 8 ) += 3.0f / 16.0f * err;
-				ringbuffer( 8 + DiffusionX         , ( DiffusionY + radius ) % 8 ) += 5.0f / 16.0f * err;
-				ringbuffer( 8 + DiffusionX + radius, ( DiffusionY + radius ) % 8 ) += 1.0f / 16.0f * err;
-				crc32 = ( crc32 >> 1 ) ^ 0xedb88320;	// Zufallszahl aktualisieren
-			}
-			else
-			{
-				ringbuffer( 8 + DiffusionX + radius, ( DiffusionY          ) % 8 ) += 2.0f / 16.0f * err;
-				ringbuffer( 8 + DiffusionX - radius, ( DiffusionY + radius ) % 8 ) += 6.0f / 16.0f * err;
-				ringbuffer( 8 + DiffusionX         , ( DiffusionY + radius ) % 8 ) += 2.0f / 16.0f * err;
-				ringbuffer( 8 + DiffusionX + radius, ( DiffusionY + radius ) % 8 ) += 6.0f / 16.0f * err;
-				crc32 >>= 1;	// Zufallszahl aktualisieren
-			}
-		} // for x
-	} // for y
+				// Zufällig in die eine oder andere Richtung diffundieren,
+				// um Spuren zu verwischen.
+				if( ( crc32 ^ radius ) & 1 )
+				{
+					ringbuffer( 8 + DiffusionX + radius, ( DiffusionY          ) % 8 ) += 7.0f / 16.0f * err;
+					ringbuffer( 8 + DiffusionX - radius, ( DiffusionY + radius ) % 8 ) += 3.0f / 16.0f * err;
+					ringbuffer( 8 + DiffusionX         , ( DiffusionY + radius ) % 8 ) += 5.0f / 16.0f * err;
+					ringbuffer( 8 + DiffusionX + radius, ( DiffusionY + radius ) % 8 ) += 1.0f / 16.0f * err;
+					crc32 = ( crc32 >> 1 ) ^ 0xedb88320;	// Zufallszahl aktualisieren
+				}
+				else
+				{
+					ringbuffer( 8 + DiffusionX + radius, ( DiffusionY          ) % 8 ) += 2.0f / 16.0f * err;
+					ringbuffer( 8 + DiffusionX - radius, ( DiffusionY + radius ) % 8 ) += 6.0f / 16.0f * err;
+					ringbuffer( 8 + DiffusionX         , ( DiffusionY + radius ) % 8 ) += 2.0f / 16.0f * err;
+					ringbuffer( 8 + DiffusionX + radius, ( DiffusionY + radius ) % 8 ) += 6.0f / 16.0f * err;
+					crc32 >>= 1;	// Zufallszahl aktualisieren
+				}
+			} // for x
+		} // for y
+	}
+
+private:
+	unsigned int width_;
+	Eigen::MatrixXf ringbuffer;
+	unsigned int crc32;
+};
+
+}
+
+namespace detail
+{
+	std::unique_ptr<PdsRows> PdsFloydSteinbergRows(unsigned width, unsigned height)
+	{ return std::unique_ptr<PdsRows>(new FloydSteinbergRows(width, height)); }
+
+	std::unique_ptr<PdsRows> PdsFloydSteinbergExpoRows(unsigned width)
+	{ return std::unique_ptr<PdsRows>(new FloydSteinbergExpoRows(width)); }
+}
+
+std::vector<Eigen::Vector2f> PdsFloydSteinberg(const Eigen::MatrixXf& density)
+{
+	std::vector<Eigen::Vector2f> seeds;
+	detail::PdsFloydSteinbergRows(density.rows(), density.cols())->add(0, density, seeds);
+	return seeds;
+}
+
+std::vector<Eigen::Vector2f> PdsFloydSteinbergExpo(const Eigen::MatrixXf& density)
+{
+	std::vector<Eigen::Vector2f> seeds;
+	detail::PdsFloydSteinbergExpoRows(density.rows())->add(0, density, seeds);
 	return seeds;
 }
 
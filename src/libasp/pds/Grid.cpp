@@ -1,29 +1,86 @@
+#include "PdsRows.hpp"
 #include <Eigen/Dense>
 #include <vector>
 #include <random>
+#include <cmath>
 
 namespace asp
 {
 
-std::vector<Eigen::Vector2f> PdsRandom(const Eigen::MatrixXf& density)
+std::vector<Eigen::Vector2f> PdsGrid(unsigned width, unsigned height, float total);
+
+namespace
+{
+
+class RandomRows : public detail::PdsRows
 {
+public:
+	void add(unsigned y_begin, const Eigen::MatrixXf& density, std::vector<Eigen::Vector2f>& seeds) override
+	{
+		for(unsigned int iy=0; iy<density.cols(); iy++) {
+			for(unsigned int ix=0; ix<density.rows(); ix++) {
+				if(unif(rnd_engine) < density(ix,iy))
+					seeds.push_back(Eigen::Vector2f(ix, y_begin + iy));
+			}
+		}
+	}
+
+private:
 	std::mt19937 rnd_engine; // FIXME seed?
-	std::uniform_real_distribution<float> unif(0.0f, 1.0f);
-	std::vector<Eigen::Vector2f> seeds;
-	for(unsigned int iy=0; iy<density.cols(); iy++) {
-		for(unsigned int ix=0; ix<density.rows(); ix++) {
-			if(unif(rnd_engine) < density(ix,iy))
-				seeds.push_back(Eigen::Vector2f(ix, iy));
+	std::uniform_real_distribution<float> unif{0.0f, 1.0f};
+};
+
+/** Grid sampling only depends on the total density, thus samples are computed with the last row */
+class GridRows : public detail::PdsRows
+{
+public:
+	GridRows(unsigned width, unsigned height)
+	:	width_(width), height_(height), rows_(0), total_(0.0)
+	{}
+
+	void add(unsigned, const Eigen::MatrixXf& density, std::vector<Eigen::Vector2f>& seeds) override
+	{
+		// same summation order as DensityIntegral::total
+		for(unsigned int iy=0; iy<density.cols(); iy++) {
+			for(unsigned int ix=0; ix<density.rows(); ix++) {
+				total_ += static_cast<double>(density(ix,iy));
+			}
+		}
+		rows_ += density.cols();
+		if(rows_ == height_ && density.cols() > 0) {
+			const std::vector<Eigen::Vector2f> grid = PdsGrid(width_, height_, total_);
+			seeds.insert(seeds.end(), grid.begin(), grid.end());
 		}
 	}
+
+private:
+	unsigned width_, height_;
+	unsigned rows_;
+	double total_;
+};
+
+}
+
+namespace detail
+{
+	std::unique_ptr<PdsRows> PdsRandomRows()
+	{ return std::unique_ptr<PdsRows>(new RandomRows()); }
+
+	std::unique_ptr<PdsRows> PdsGridRows(unsigned width, unsigned height)
+	{ return std::unique_ptr<PdsRows>(new GridRows(width, height)); }
+}
+
+std::vector<Eigen::Vector2f> PdsRandom(const Eigen::MatrixXf& density)
+{
+	std::vector<Eigen::Vector2f> seeds;
+	detail::PdsRandomRows()->add(0, density, seeds);
 	return seeds;
 }
 
-std::vector<Eigen::Vector2f> PdsGrid(const Eigen::MatrixXf& density)
+std::vector<Eigen::Vector2f> PdsGrid(unsigned width_px, unsigned height_px, float numf)
 {
-	const float width = static_cast<float>(density.rows());
-	const float height = static_cast<float>(density.cols());
-	const float numf = density.sum();
+	const float width = static_cast<float>(width_px);
+	const float height = static_cast<float>(height_px);
 	const float d = std::sqrt(float(width*height) / numf);
 	const unsigned int Nx = static_cast<unsigned int>(std::ceil(width / d));
 	const unsigned int Ny = static_cast<unsigned int>(std::ceil(height / d));
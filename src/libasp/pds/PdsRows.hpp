@@ -0,0 +1,35 @@
+#pragma once
+
+#include <asp/execution.hpp>
+#include <Eigen/Dense>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace asp
+{
+
+namespace detail
+{
+	/** State of a sampling method which gets the density in blocks of rows from top to bottom
+	 * The whole image sampling functions use the same code with a single block.
+	 */
+	class PdsRows
+	{
+	public:
+		virtual ~PdsRows() {}
+
+		/** Samples the rows y_begin + y for the density block density(x,y)
+		 * Appends the samples which are complete (in image coordinates).
+		 */
+		virtual void add(unsigned y_begin, const Eigen::MatrixXf& density, std::vector<Eigen::Vector2f>& seeds) = 0;
+	};
+
+	std::unique_ptr<PdsRows> PdsRandomRows();
+	std::unique_ptr<PdsRows> PdsGridRows(unsigned width, unsigned height);
+	std::unique_ptr<PdsRows> PdsFloydSteinbergRows(unsigned width, unsigned height);
+	std::unique_ptr<PdsRows> PdsFloydSteinbergExpoRows(unsigned width);
+	std::unique_ptr<PdsRows> PdsRandomCounterRows(uint64_t seed, const ExecutionContext& exec);
+}
+
+}
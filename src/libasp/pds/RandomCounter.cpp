@@ -0,0 +1,97 @@
+#include <asp/pds.hpp>
+#include "PdsRows.hpp"
+#include <Eigen/Dense>
+#include <vector>
+#include <cstdint>
+
+namespace asp
+{
+
+namespace
+{
+	/** SplitMix64 finalizer, a strong 64 bit mixing function */
+	inline uint64_t SplitMix64(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	/** Random bits for a counter under a key (same result for the same key and counter) */
+	inline uint64_t CounterRandom(uint64_t key, uint64_t counter)
+	{ return SplitMix64(key + (counter + 1)*0x9E3779B97F4A7C15ull); }
+
+	/** Uniform number in [0,1) from the lowest 'bits' bits of r */
+	inline float Uniform(uint64_t r, unsigned bits)
+	{ return static_cast<float>(r & ((1ull << bits) - 1)) / static_cast<float>(1ull << bits); }
+
+	/** Position x + u inside pixel x (rounding must not move large coordinates into the next pixel) */
+	inline float Jitter(unsigned x, float u)
+	{
+		const float p = static_cast<float>(x) + u;
+		return (p < static_cast<float>(x + 1)) ? p : static_cast<float>(x);
+	}
+
+	/** Samples the rows y_begin + y of the density block density(x,y) (pixel indices are image indices) */
+	std::vector<Eigen::Vector2f> RandomCounterBlock(const Eigen::MatrixXf& density, unsigned y_begin, uint64_t seed, const ExecutionContext& exec)
+	{
+		const unsigned width = density.rows();
+		const unsigned height = density.cols();
+		const uint64_t key = SplitMix64(seed);
+		const size_t num_bands = exec.numChunks(height);
+		std::vector<std::vector<Eigen::Vector2f>> band_seeds(num_bands);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			auto& seeds = band_seeds[band];
+			const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+			const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+			for(unsigned y=y1; y<y2; y++) {
+				for(unsigned x=0; x<width; x++) {
+					// one 64 bit random number per pixel: 24 bits for acceptance, 20 bits per jitter coordinate
+					const uint64_t r = CounterRandom(key, static_cast<uint64_t>(y_begin + y)*width + x);
+					if(Uniform(r, 24) < density(x,y)) {
+						seeds.push_back(Eigen::Vector2f(
+							Jitter(x, Uniform(r >> 24, 20)),
+							Jitter(y_begin + y, Uniform(r >> 44, 20))));
+					}
+				}
+			}
+		});
+		// concatenate in band order, thus the result does not depend on the number of bands
+		std::vector<Eigen::Vector2f> seeds = std::move(band_seeds.front());
+		for(size_t band=1; band<num_bands; band++) {
+			seeds.insert(seeds.end(), band_seeds[band].begin(), band_seeds[band].end());
+		}
+		return seeds;
+	}
+
+	class RandomCounterRows : public detail::PdsRows
+	{
+	public:
+		RandomCounterRows(uint64_t seed, const ExecutionContext& exec)
+		:	seed_(seed), exec_(exec)
+		{}
+
+		void add(unsigned y_begin, const Eigen::MatrixXf& density, std::vector<Eigen::Vector2f>& seeds) override
+		{
+			const std::vector<Eigen::Vector2f> block = RandomCounterBlock(density, y_begin, seed_, exec_);
+			seeds.insert(seeds.end(), block.begin(), block.end());
+		}
+
+	private:
+		uint64_t seed_;
+		ExecutionContext exec_;
+	};
+}
+
+namespace detail
+{
+	std::unique_ptr<PdsRows> PdsRandomCounterRows(uint64_t seed, const ExecutionContext& exec)
+	{ return std::unique_ptr<PdsRows>(new RandomCounterRows(seed, exec)); }
+}
+
+std::vector<Eigen::Vector2f> PdsRandomCounter(const Eigen::MatrixXf& density, uint64_t seed, const ExecutionContext& exec)
+{
+	return RandomCounterBlock(density, 0, seed, exec);
+}
+
+}
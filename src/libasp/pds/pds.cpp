@@ -1,23 +1,93 @@
 #include <asp/pds.hpp>
+#include "PdsRows.hpp"
+#include <stdexcept>
 
 namespace asp
 {
 
 std::vector<Eigen::Vector2f> PdsRandom(const Eigen::MatrixXf& density_inp);
-std::vector<Eigen::Vector2f> PdsGrid(const Eigen::MatrixXf& density_inp);
+std::vector<Eigen::Vector2f> PdsGrid(unsigned width, unsigned height, float total);
 std::vector<Eigen::Vector2f> PdsFloydSteinberg(const Eigen::MatrixXf& density_inp);
 std::vector<Eigen::Vector2f> PdsFloydSteinbergExpo(const Eigen::MatrixXf& density_inp);
 
+namespace
+{
+	/** Samples with the given method, total() is only called for grid sampling */
+	template<typename Total>
+	std::vector<Eigen::Vector2f> Sample(PoissonDiskSamplingMethod method, const Eigen::MatrixXf& density, Total total, const ExecutionContext& exec, uint64_t random_seed)
+	{
+		#define OPT(Q) case PoissonDiskSamplingMethod::Q: return Pds##Q(density);
+		switch(method) {
+			OPT(Random)
+			case PoissonDiskSamplingMethod::Grid: return PdsGrid(density.rows(), density.cols(), total());
+			OPT(FloydSteinberg)
+			OPT(FloydSteinbergExpo)
+			case PoissonDiskSamplingMethod::RandomCounter: return PdsRandomCounter(density, random_seed, exec);
+			default: return {};
+		}
+		#undef OPT
+	}
+}
+
 std::vector<Eigen::Vector2f> PoissonDiskSampling(PoissonDiskSamplingMethod method, const Eigen::MatrixXf& density)
 {
-	#define OPT(Q) case PoissonDiskSamplingMethod::Q: return Pds##Q(density);
+	return Sample(method, density,
+		[&density]() {
+			// same summation order as DensityIntegral::total
+			double total = 0.0;
+			for(int y=0; y<density.cols(); y++) {
+				for(int x=0; x<density.rows(); x++) {
+					total += static_cast<double>(density(x,y));
+				}
+			}
+			return total;
+		},
+		ExecutionContext::Serial(), 0);
+}
+
+std::vector<Eigen::Vector2f> PoissonDiskSampling(PoissonDiskSamplingMethod method, const Eigen::MatrixXf& density, const DensityIntegral& integral, const ExecutionContext& exec, uint64_t random_seed)
+{
+	return Sample(method, density, [&integral]() { return integral.total(); }, exec, random_seed);
+}
+
+struct PoissonDiskSampler::Impl
+{
+	unsigned width, height;
+	unsigned rows;
+	std::unique_ptr<detail::PdsRows> sampler;
+};
+
+PoissonDiskSampler::PoissonDiskSampler(PoissonDiskSamplingMethod method, unsigned width, unsigned height, const ExecutionContext& exec, uint64_t random_seed)
+:	impl_(new Impl())
+{
+	impl_->width = width;
+	impl_->height = height;
+	impl_->rows = 0;
 	switch(method) {
-		OPT(Random)
-		OPT(Grid)
-		OPT(FloydSteinberg)
-		OPT(FloydSteinbergExpo)
-		default: return {};
+	case PoissonDiskSamplingMethod::Random: impl_->sampler = detail::PdsRandomRows(); break;
+	case PoissonDiskSamplingMethod::Grid: impl_->sampler = detail::PdsGridRows(width, height); break;
+	case PoissonDiskSamplingMethod::FloydSteinberg: impl_->sampler = detail::PdsFloydSteinbergRows(width, height); break;
+	case PoissonDiskSamplingMethod::FloydSteinbergExpo: impl_->sampler = detail::PdsFloydSteinbergExpoRows(width); break;
+	case PoissonDiskSamplingMethod::RandomCounter: impl_->sampler = detail::PdsRandomCounterRows(random_seed, exec); break;
+	default: throw std::runtime_error("PoissonDiskSampler: unknown sampling method");
 	}
 }
 
+PoissonDiskSampler::~PoissonDiskSampler()
+{}
+
+std::vector<Eigen::Vector2f> PoissonDiskSampler::add(const Eigen::MatrixXf& density)
+{
+	if(density.rows() != impl_->width || impl_->rows + density.cols() > impl_->height) {
+		throw std::runtime_error("PoissonDiskSampler: rows do not fit the image");
+	}
+	std::vector<Eigen::Vector2f> seeds;
+	impl_->sampler->add(impl_->rows, density, seeds);
+	impl_->rows += density.cols();
+	return seeds;
+}
+
+unsigned PoissonDiskSampler::rows() const
+{ return impl_->rows; }
+
 }
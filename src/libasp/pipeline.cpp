@@ -0,0 +1,204 @@
+#include <asp/pipeline.hpp>
+#include <boost/thread.hpp>
+#include <deque>
+#include <stdexcept>
+
+namespace asp
+{
+
+	namespace
+	{
+		/** Queue with limited capacity which blocks on push if full and on pop if empty */
+		template<typename T>
+		class BoundedQueue
+		{
+		public:
+			explicit BoundedQueue(unsigned capacity)
+			:	capacity_(std::max(capacity, 1u)), closed_(false)
+			{}
+
+			void push(T&& item)
+			{
+				boost::unique_lock<boost::mutex> lock(mutex_);
+				while(items_.size() >= capacity_) {
+					cond_not_full_.wait(lock);
+				}
+				items_.push_back(std::move(item));
+				cond_not_empty_.notify_one();
+			}
+
+			/** Returns false if the queue is closed and empty */
+			bool pop(T& item)
+			{
+				boost::unique_lock<boost::mutex> lock(mutex_);
+				while(items_.empty() && !closed_) {
+					cond_not_empty_.wait(lock);
+				}
+				if(items_.empty()) {
+					return false;
+				}
+				item = std::move(items_.front());
+				items_.pop_front();
+				cond_not_full_.notify_one();
+				return true;
+			}
+
+			/** No more items will be pushed */
+			void close()
+			{
+				boost::lock_guard<boost::mutex> lock(mutex_);
+				closed_ = true;
+				cond_not_empty_.notify_all();
+			}
+
+		private:
+			unsigned capacity_;
+			bool closed_;
+			std::deque<T> items_;
+			boost::mutex mutex_;
+			boost::condition_variable cond_not_empty_;
+			boost::condition_variable cond_not_full_;
+		};
+
+		/** Closes a queue when going out of scope, so the next stage terminates on every exit path */
+		template<typename T>
+		struct CloseOnExit
+		{
+			BoundedQueue<T>& queue;
+			~CloseOnExit()
+			{ queue.close(); }
+		};
+
+		/** A frame travelling through the pipeline */
+		struct Frame
+		{
+			slimage::Image3ub color;
+			slimage::Image1ui16 depth;
+			RawFrameView view; // used instead of color and depth if view.color is set
+			slimage::Image<Pixel<PixelRgbd>,1> pixels;
+			float density_scale = 1.0f;
+			std::vector<Seed> seeds;
+			Segmentation<PixelRgbd> superpixels;
+			std::promise<Segmentation<PixelRgbd>> result;
+		};
+	}
+
+	struct DaspPipeline::Impl
+	{
+		DaspParameters opt;
+		PostProcess post;
+		ExecutionContext exec;
+		BoundedQueue<Frame> q_preprocess;
+		BoundedQueue<Frame> q_clustering;
+		BoundedQueue<Frame> q_post;
+		boost::thread_group threads;
+		DaspCamera camera; // only used by the preprocessing thread
+
+		Impl(const DaspParameters& opt, PostProcess post, unsigned queue_size, const ExecutionContext& exec)
+		:	opt(opt), post(post), exec(exec),
+			q_preprocess(queue_size), q_clustering(queue_size), q_post(queue_size)
+		{}
+
+		void preprocess()
+		{
+			CloseOnExit<Frame> close{q_clustering};
+			Frame frame;
+			while(q_preprocess.pop(frame)) {
+				try {
+					const bool is_view = (frame.view.color != nullptr);
+					const unsigned width = is_view ? frame.view.width : frame.depth.width();
+					const unsigned height = is_view ? frame.view.height : frame.depth.height();
+					if(!camera.matches(width, height, opt)) {
+						camera = DaspCamera(width, height, opt);
+					}
+					frame.pixels = is_view
+						? DaspPixels(frame.view, camera, opt, exec, &frame.density_scale)
+						: DaspPixels(frame.color, frame.depth, camera, opt, exec, &frame.density_scale);
+					frame.seeds = DaspSeeds(frame.pixels, exec);
+				}
+				catch(...) {
+					// failed frames leave the pipeline here
+					frame.result.set_exception(std::current_exception());
+					continue;
+				}
+				// input images are not needed anymore
+				frame.color = slimage::Image3ub();
+				frame.depth = slimage::Image1ui16();
+				frame.view = RawFrameView();
+				q_clustering.push(std::move(frame));
+			}
+		}
+
+		void clustering()
+		{
+			CloseOnExit<Frame> close{q_post};
+			Frame frame;
+			while(q_clustering.pop(frame)) {
+				try {
+					frame.superpixels = DaspClustering(frame.pixels, frame.seeds, opt, exec);
+					frame.superpixels.density_scale = frame.density_scale;
+				}
+				catch(...) {
+					frame.result.set_exception(std::current_exception());
+					continue;
+				}
+				q_post.push(std::move(frame));
+			}
+		}
+
+		void postprocess()
+		{
+			Frame frame;
+			while(q_post.pop(frame)) {
+				try {
+					if(post) {
+						post(frame.superpixels);
+					}
+					frame.result.set_value(frame.superpixels);
+				}
+				catch(...) {
+					frame.result.set_exception(std::current_exception());
+				}
+			}
+		}
+	};
+
+	DaspPipeline::DaspPipeline(const DaspParameters& opt, PostProcess post, unsigned queue_size, const ExecutionContext& exec)
+	:	impl_(new Impl(opt, post, queue_size, exec))
+	{
+		Impl* impl = impl_.get();
+		impl_->threads.create_thread([impl]() { impl->preprocess(); });
+		impl_->threads.create_thread([impl]() { impl->clustering(); });
+		impl_->threads.create_thread([impl]() { impl->postprocess(); });
+	}
+
+	DaspPipeline::~DaspPipeline()
+	{
+		// closing the first queue lets the stages finish one after the other
+		impl_->q_preprocess.close();
+		impl_->threads.join_all();
+	}
+
+	std::future<Segmentation<PixelRgbd>> DaspPipeline::push(const slimage::Image3ub& color, const slimage::Image1ui16& depth)
+	{
+		Frame frame;
+		frame.color = color;
+		frame.depth = depth;
+		std::future<Segmentation<PixelRgbd>> result = frame.result.get_future();
+		impl_->q_preprocess.push(std::move(frame));
+		return result;
+	}
+
+	std::future<Segmentation<PixelRgbd>> DaspPipeline::push(const RawFrameView& view)
+	{
+		if(view.color == nullptr || view.depth == nullptr) {
+			throw std::runtime_error("DaspPipeline::push: frame view without color or depth data");
+		}
+		Frame frame;
+		frame.view = view;
+		std::future<Segmentation<PixelRgbd>> result = frame.result.get_future();
+		impl_->q_preprocess.push(std::move(frame));
+		return result;
+	}
+
+}
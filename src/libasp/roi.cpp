@@ -0,0 +1,182 @@
+#include <asp/roi.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace asp
+{
+
+	void detail::CheckMaskSize(const slimage::Image1ub& mask, unsigned width, unsigned height)
+	{
+		if(mask.width() != width || mask.height() != height) {
+			throw std::runtime_error("Mask must have the same size as the image");
+		}
+	}
+
+	slimage::Image1ub RoiMask(unsigned width, unsigned height, const std::vector<Roi>& rois)
+	{
+		slimage::Image1ub mask{width, height};
+		std::fill(mask.begin(), mask.end(), 0);
+		for(const Roi& roi : rois) {
+			const unsigned x2 = std::min(roi.x + roi.width, width);
+			const unsigned y2 = std::min(roi.y + roi.height, height);
+			for(unsigned y=roi.y; y<y2; y++) {
+				for(unsigned x=roi.x; x<x2; x++) {
+					mask(x,y) = 1;
+				}
+			}
+		}
+		return mask;
+	}
+
+	Roi MaskBoundingBox(const slimage::Image1ub& mask, const ExecutionContext& exec)
+	{
+		const unsigned width = mask.width();
+		const unsigned height = mask.height();
+		// bounding box per band as [x1,x2) x [y1,y2)
+		const size_t num_bands = exec.numChunks(height);
+		std::vector<Roi> band_box(num_bands, Roi{width, height, 0, 0});
+		exec.parallel_for(num_bands, [&](size_t band) {
+			const unsigned y1 = detail::ChunkBegin(height, num_bands, band);
+			const unsigned y2 = detail::ChunkBegin(height, num_bands, band + 1);
+			Roi& b = band_box[band];
+			for(unsigned y=y1; y<y2; y++) {
+				for(unsigned x=0; x<width; x++) {
+					if(mask(x,y)) {
+						b.x = std::min(b.x, x);
+						b.width = std::max(b.width, x + 1);
+						b.y = std::min(b.y, y);
+						b.height = std::max(b.height, y + 1);
+					}
+				}
+			}
+		});
+		Roi box{width, height, 0, 0};
+		for(const Roi& b : band_box) {
+			box.x = std::min(box.x, b.x);
+			box.y = std::min(box.y, b.y);
+			box.width = std::max(box.width, b.width);
+			box.height = std::max(box.height, b.height);
+		}
+		if(box.width <= box.x || box.height <= box.y) {
+			return Roi{0, 0, 0, 0};
+		}
+		return Roi{box.x, box.y, box.width - box.x, box.height - box.y};
+	}
+
+	std::vector<Roi> MergeRois(unsigned width, unsigned height, const std::vector<Roi>& rois)
+	{
+		// boxes as [x,width) x [y,height) while merging
+		std::vector<Roi> boxes;
+		for(const Roi& roi : rois) {
+			const unsigned x2 = std::min(roi.x + roi.width, width);
+			const unsigned y2 = std::min(roi.y + roi.height, height);
+			if(roi.x < x2 && roi.y < y2) {
+				boxes.push_back(Roi{roi.x, roi.y, x2, y2});
+			}
+		}
+		auto overlap = [](const Roi& a, const Roi& b) {
+			return a.x < b.width && b.x < a.width && a.y < b.height && b.y < a.height;
+		};
+		// a merged box may overlap boxes which did not overlap its parts, thus repeat until nothing changes
+		bool merged = true;
+		while(merged) {
+			merged = false;
+			for(size_t i=0; i<boxes.size(); i++) {
+				size_t j = i + 1;
+				while(j < boxes.size()) {
+					if(overlap(boxes[i], boxes[j])) {
+						Roi& a = boxes[i];
+						const Roi& b = boxes[j];
+						a = Roi{std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.width, b.width), std::max(a.height, b.height)};
+						boxes.erase(boxes.begin() + j);
+						j = i + 1;
+						merged = true;
+					}
+					else {
+						j++;
+					}
+				}
+			}
+		}
+		for(Roi& b : boxes) {
+			b.width -= b.x;
+			b.height -= b.y;
+		}
+		std::sort(boxes.begin(), boxes.end(),
+			[](const Roi& a, const Roi& b) { return a.y < b.y || (a.y == b.y && a.x < b.x); });
+		return boxes;
+	}
+
+	std::vector<Roi> MaskRegions(const slimage::Image1ub& mask, const ExecutionContext& exec)
+	{
+		const int width = mask.width();
+		const int height = mask.height();
+		// runs of mask pixels per row (the run label is the row)
+		const size_t num_bands = exec.numChunks(height);
+		std::vector<std::vector<detail::LabelRun>> band_runs(num_bands);
+		std::vector<size_t> row_size(height, 0);
+		exec.parallel_for(num_bands, [&](size_t band) {
+			auto& runs = band_runs[band];
+			const int y1 = detail::ChunkBegin(height, num_bands, band);
+			const int y2 = detail::ChunkBegin(height, num_bands, band + 1);
+			for(int y=y1; y<y2; y++) {
+				const size_t size_before = runs.size();
+				int x = 0;
+				while(x < width) {
+					if(!mask(x,y)) {
+						x++;
+						continue;
+					}
+					const int xa = x;
+					while(x < width && mask(x,y)) {
+						x++;
+					}
+					runs.push_back({xa, x, y});
+				}
+				row_size[y] = runs.size() - size_before;
+			}
+		});
+		std::vector<detail::LabelRun> runs;
+		for(const auto& r : band_runs) {
+			runs.insert(runs.end(), r.begin(), r.end());
+		}
+		std::vector<size_t> row_begin(height + 1, 0);
+		for(int y=0; y<height; y++) {
+			row_begin[y+1] = row_begin[y] + row_size[y];
+		}
+		// connected components of runs in consecutive rows with overlapping x range
+		detail::RunForest forest;
+		forest.parent.resize(runs.size());
+		for(size_t i=0; i<runs.size(); i++) {
+			forest.parent[i] = i;
+		}
+		for(int y=1; y<height; y++) {
+			detail::ForEachRunOverlap(runs, row_begin[y-1], row_begin[y], row_begin[y], row_begin[y+1],
+				[&forest](size_t i, size_t j, int) { forest.unite(i, j); });
+		}
+		// bounding box per component as [x,width) x [y,height)
+		std::vector<Roi> boxes;
+		std::vector<int> box_index(runs.size(), -1);
+		for(size_t i=0; i<runs.size(); i++) {
+			const detail::LabelRun& r = runs[i];
+			const unsigned x1 = r.x1, x2 = r.x2, y = r.label;
+			int& k = box_index[forest.find(i)];
+			if(k == -1) {
+				k = boxes.size();
+				boxes.push_back(Roi{x1, y, x2, y + 1});
+			}
+			else {
+				Roi& b = boxes[k];
+				b.x = std::min(b.x, x1);
+				b.width = std::max(b.width, x2);
+				b.height = std::max(b.height, y + 1);
+			}
+		}
+		for(Roi& b : boxes) {
+			b.width -= b.x;
+			b.height -= b.y;
+		}
+		return MergeRois(width, height, boxes);
+	}
+
+}
@@ -0,0 +1,211 @@
+#include <asp/sequence.hpp>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace asp
+{
+
+	namespace
+	{
+		const char c_magic[8] = "ASPRGBD";
+		const uint32_t c_version = 1;
+
+		/** Blocks are padded such that depth values are properly aligned */
+		size_t Padded(size_t n)
+		{ return (n + 7) / 8 * 8; }
+
+		size_t ColorBlockSize(unsigned width, unsigned height)
+		{ return Padded(static_cast<size_t>(width)*height*3); }
+
+		size_t DepthBlockSize(unsigned width, unsigned height)
+		{ return Padded(static_cast<size_t>(width)*height*sizeof(uint16_t)); }
+
+		size_t HeaderSize()
+		{ return Padded(sizeof(RawSequenceHeader)); }
+	}
+
+	struct RawSequenceReader::Impl
+	{
+		int fd = -1;
+		void* map = MAP_FAILED;
+		size_t map_size = 0;
+		RawSequenceHeader header;
+		size_t color_size, frame_size;
+
+		const unsigned char* frame(size_t i) const
+		{
+			if(i >= header.num_frames) {
+				throw std::out_of_range("RawSequenceReader: frame index out of range");
+			}
+			return static_cast<const unsigned char*>(map) + HeaderSize() + i*frame_size;
+		}
+
+		~Impl()
+		{
+			if(map != MAP_FAILED) {
+				munmap(map, map_size);
+			}
+			if(fd != -1) {
+				::close(fd);
+			}
+		}
+	};
+
+	RawSequenceReader::RawSequenceReader(const std::string& filename)
+	:	impl_(new Impl())
+	{
+		impl_->fd = open(filename.c_str(), O_RDONLY);
+		if(impl_->fd == -1) {
+			throw std::runtime_error("RawSequenceReader: could not open '" + filename + "'");
+		}
+		struct stat st;
+		if(fstat(impl_->fd, &st) != 0 || static_cast<size_t>(st.st_size) < HeaderSize()) {
+			throw std::runtime_error("RawSequenceReader: '" + filename + "' is not a raw sequence");
+		}
+		impl_->map_size = st.st_size;
+		impl_->map = mmap(nullptr, impl_->map_size, PROT_READ, MAP_PRIVATE, impl_->fd, 0);
+		if(impl_->map == MAP_FAILED) {
+			throw std::runtime_error("RawSequenceReader: could not map '" + filename + "'");
+		}
+		// frames are usually read in order
+		madvise(impl_->map, impl_->map_size, MADV_SEQUENTIAL);
+		RawSequenceHeader& h = impl_->header;
+		std::memcpy(&h, impl_->map, sizeof(RawSequenceHeader));
+		if(std::memcmp(h.magic, c_magic, sizeof(c_magic)) != 0 || h.version != c_version) {
+			throw std::runtime_error("RawSequenceReader: '" + filename + "' is not a raw sequence");
+		}
+		impl_->color_size = ColorBlockSize(h.width, h.height);
+		impl_->frame_size = impl_->color_size + DepthBlockSize(h.width, h.height);
+		if(HeaderSize() + h.num_frames*impl_->frame_size > impl_->map_size) {
+			throw std::runtime_error("RawSequenceReader: '" + filename + "' is truncated");
+		}
+	}
+
+	RawSequenceReader::~RawSequenceReader()
+	{}
+
+	unsigned RawSequenceReader::width() const
+	{ return impl_->header.width; }
+
+	unsigned RawSequenceReader::height() const
+	{ return impl_->header.height; }
+
+	size_t RawSequenceReader::numFrames() const
+	{ return impl_->header.num_frames; }
+
+	const unsigned char* RawSequenceReader::colorData(size_t i) const
+	{ return impl_->frame(i); }
+
+	const uint16_t* RawSequenceReader::depthData(size_t i) const
+	{ return reinterpret_cast<const uint16_t*>(impl_->frame(i) + impl_->color_size); }
+
+	RawFrameView RawSequenceReader::frame(size_t i) const
+	{
+		RawFrameView view;
+		view.width = width();
+		view.height = height();
+		view.color = colorData(i);
+		view.depth = depthData(i);
+		return view;
+	}
+
+	slimage::Image3ub RawSequenceReader::color(size_t i) const
+	{
+		const unsigned char* src = colorData(i);
+		slimage::Image3ub img{width(), height()};
+		for(size_t k=0; k<img.size(); k++, src+=3) {
+			img[k] = slimage::Pixel3ub{src[0], src[1], src[2]};
+		}
+		return img;
+	}
+
+	slimage::Image1ui16 RawSequenceReader::depth(size_t i) const
+	{
+		const uint16_t* src = depthData(i);
+		slimage::Image1ui16 img{width(), height()};
+		std::copy(src, src + img.size(), img.begin());
+		return img;
+	}
+
+	RawSequenceWriter::RawSequenceWriter(const std::string& filename, unsigned width, unsigned height)
+	:	ofs_(filename, std::ios::binary | std::ios::trunc),
+		width_(width), height_(height), num_frames_(0)
+	{
+		if(!ofs_) {
+			throw std::runtime_error("RawSequenceWriter: could not open '" + filename + "'");
+		}
+		writeHeader();
+	}
+
+	RawSequenceWriter::~RawSequenceWriter()
+	{
+		if(ofs_.is_open()) {
+			// do not throw from the destructor
+			try {
+				close();
+			}
+			catch(...) {}
+		}
+	}
+
+	void RawSequenceWriter::write(const slimage::Image3ub& color, const slimage::Image1ui16& depth)
+	{
+		if(color.width() != width_ || color.height() != height_ || depth.width() != width_ || depth.height() != height_) {
+			throw std::runtime_error("RawSequenceWriter: frame dimensions do not match");
+		}
+		std::vector<unsigned char> buffer(ColorBlockSize(width_, height_) + DepthBlockSize(width_, height_), 0);
+		unsigned char* dst = buffer.data();
+		for(size_t k=0; k<color.size(); k++, dst+=3) {
+			const auto& px = color[k];
+			dst[0] = px[0];
+			dst[1] = px[1];
+			dst[2] = px[2];
+		}
+		uint16_t* dst_depth = reinterpret_cast<uint16_t*>(buffer.data() + ColorBlockSize(width_, height_));
+		std::copy(depth.begin(), depth.end(), dst_depth);
+		ofs_.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+		if(!ofs_) {
+			throw std::runtime_error("RawSequenceWriter: write failed");
+		}
+		num_frames_++;
+	}
+
+	void RawSequenceWriter::close()
+	{
+		writeHeader();
+		ofs_.close();
+		if(!ofs_) {
+			throw std::runtime_error("RawSequenceWriter: write failed");
+		}
+	}
+
+	void RawSequenceWriter::writeHeader()
+	{
+		RawSequenceHeader h;
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h.magic, c_magic, sizeof(c_magic));
+		h.version = c_version;
+		h.width = width_;
+		h.height = height_;
+		h.num_frames = num_frames_;
+		std::vector<char> buffer(HeaderSize(), 0);
+		std::memcpy(buffer.data(), &h, sizeof(h));
+		// keep the write position if frames have been written already
+		const std::streampos pos = ofs_.tellp();
+		ofs_.seekp(0);
+		ofs_.write(buffer.data(), buffer.size());
+		if(pos > ofs_.tellp()) {
+			ofs_.seekp(pos);
+		}
+		if(!ofs_) {
+			throw std::runtime_error("RawSequenceWriter: write failed");
+		}
+	}
+
+}
@@ -0,0 +1,37 @@
+#include <asp/surfels.hpp>
+#include <stdexcept>
+
+namespace asp
+{
+
+	SurfelWriter::SurfelWriter(std::ostream& os, bool with_covariance)
+	:	os_(&os), with_covariance_(with_covariance), num_frames_(0)
+	{}
+
+	void SurfelWriter::write(const SurfelFrame& frame)
+	{
+		const size_t num_covariances = with_covariance_ ? frame.surfels.size() : 0;
+		if(frame.covariances.size() != num_covariances) {
+			throw std::runtime_error(with_covariance_
+				? "SurfelWriter: number of covariances does not match number of surfels"
+				: "SurfelWriter: frame has covariances but the writer was created without covariances");
+		}
+		const uint32_t header[3] = {
+			static_cast<uint32_t>(num_frames_),
+			static_cast<uint32_t>(frame.surfels.size()),
+			with_covariance_ ? 1u : 0u
+		};
+		os_->write("SURF", 4);
+		os_->write(reinterpret_cast<const char*>(header), sizeof(header));
+		os_->write(reinterpret_cast<const char*>(frame.surfels.data()), frame.surfels.size()*sizeof(Surfel));
+		if(with_covariance_) {
+			os_->write(reinterpret_cast<const char*>(frame.covariances.data()), frame.covariances.size()*sizeof(SurfelCovariance));
+		}
+		os_->flush();
+		if(!*os_) {
+			throw std::runtime_error("SurfelWriter: write failed");
+		}
+		num_frames_++;
+	}
+
+}
@@ -0,0 +1,230 @@
+#include <asp/algos.hpp>
+#include <slimage/image.hpp>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace py = pybind11;
+
+namespace
+{
+	template<typename K>
+	using InputArray = py::array_t<K, py::array::c_style | py::array::forcecast>;
+
+	/** Image size (width, height) of a HxW or HxWxC array, throws ValueError for other shapes and empty arrays */
+	std::pair<unsigned,unsigned> ImageSize(const py::array& a, unsigned channels, const char* name)
+	{
+		const bool ok = (channels == 1)
+			? (a.ndim() == 2 || (a.ndim() == 3 && a.shape(2) == 1))
+			: (a.ndim() == 3 && a.shape(2) == channels);
+		if(!ok) {
+			throw py::value_error(std::string(name) + " must have shape (height, width" + (channels == 1 ? ")" : ", " + std::to_string(channels) + ")"));
+		}
+		if(a.shape(0) == 0 || a.shape(1) == 0) {
+			throw py::value_error(std::string(name) + " must not be empty");
+		}
+		return std::make_pair(static_cast<unsigned>(a.shape(1)), static_cast<unsigned>(a.shape(0)));
+	}
+
+	void CheckSameSize(const std::pair<unsigned,unsigned>& a, const std::pair<unsigned,unsigned>& b, const char* name)
+	{
+		if(a != b) {
+			throw py::value_error(std::string(name) + " must have the same size as color");
+		}
+	}
+
+	/** View of a C-contiguous array which stays alive during the call (pixels are read in place) */
+	template<typename K, unsigned CC>
+	asp::ImageView<K,CC> View(const InputArray<K>& a, const std::pair<unsigned,unsigned>& size)
+	{
+		asp::ImageView<K,CC> view;
+		view.width = size.first;
+		view.height = size.second;
+		view.data = a.data();
+		return view;
+	}
+
+	/** Execution context shared by all calls of the module (serial until set_threads is called) */
+	struct ModuleExecution
+	{
+		std::mutex mutex;
+		std::shared_ptr<const asp::ExecutionContext> exec = std::make_shared<asp::ExecutionContext>(1);
+	};
+
+	ModuleExecution& GetModuleExecution()
+	{
+		static ModuleExecution module_exec;
+		return module_exec;
+	}
+
+	/** The current module context (calls in flight keep using the context they started with) */
+	std::shared_ptr<const asp::ExecutionContext> Execution()
+	{
+		ModuleExecution& m = GetModuleExecution();
+		std::lock_guard<std::mutex> lock(m.mutex);
+		return m.exec;
+	}
+
+	void SetThreads(unsigned threads)
+	{
+		std::shared_ptr<const asp::ExecutionContext> exec = std::make_shared<asp::ExecutionContext>(threads);
+		ModuleExecution& m = GetModuleExecution();
+		std::lock_guard<std::mutex> lock(m.mutex);
+		// the previous context is released after the lock (its workers are joined if no call uses it)
+		m.exec.swap(exec);
+	}
+
+	asp::AlicParameters Alic(unsigned iterations, unsigned stride, bool boundary_refinement, bool enforce_connectivity, float time_budget_ms)
+	{
+		asp::AlicParameters opt;
+		opt.iterations = iterations;
+		opt.stride = stride;
+		opt.boundary_refinement = boundary_refinement;
+		opt.enforce_connectivity = enforce_connectivity;
+		opt.time_budget_ms = time_budget_ms;
+		return opt;
+	}
+
+	/** Column names of the superpixel table, one per float of Superpixel<T> */
+	const std::vector<const char*> RGB_COLUMNS = {
+		"num", "x", "y", "density", "r", "g", "b", "radius"
+	};
+
+	const std::vector<const char*> RGBD_COLUMNS = {
+		"num", "x", "y", "density", "r", "g", "b", "depth",
+		"wx", "wy", "wz", "nx", "ny", "nz", "radius"
+	};
+
+	static_assert(sizeof(asp::Superpixel<asp::PixelRgb>) == 8*sizeof(float), "superpixel table layout");
+	static_assert(sizeof(asp::Superpixel<asp::PixelRgbd>) == 15*sizeof(float), "superpixel table layout");
+
+	/** Returns the segmentation as a dict of arrays which share memory with it
+	 * The segmentation is owned by a capsule which is the base of all arrays.
+	 */
+	template<typename T>
+	py::dict ToPython(asp::Segmentation<T>&& result, const std::vector<const char*>& columns)
+	{
+		auto* seg = new asp::Segmentation<T>(std::move(result));
+		py::capsule owner(seg, [](void* p) { delete static_cast<asp::Segmentation<T>*>(p); });
+		const py::ssize_t width = seg->indices.width();
+		const py::ssize_t height = seg->indices.height();
+		const py::ssize_t num = seg->superpixels.size();
+		const py::ssize_t num_columns = columns.size();
+		py::dict d;
+		d["indices"] = py::array_t<int>({height, width}, {width*py::ssize_t(sizeof(int)), py::ssize_t(sizeof(int))},
+			&seg->indices[0], owner);
+		d["weights"] = py::array_t<float>({height, width}, {width*py::ssize_t(sizeof(float)), py::ssize_t(sizeof(float))},
+			&seg->weights[0], owner);
+		d["superpixels"] = py::array_t<float>({num, num_columns}, {py::ssize_t(sizeof(asp::Superpixel<T>)), py::ssize_t(sizeof(float))},
+			reinterpret_cast<const float*>(seg->superpixels.data()), owner);
+		py::tuple names(columns.size());
+		for(size_t i=0; i<columns.size(); i++) {
+			names[i] = py::str(columns[i]);
+		}
+		d["columns"] = names;
+		d["iterations"] = seg->iterations;
+		d["deadline_exceeded"] = seg->deadline_exceeded;
+		return d;
+	}
+}
+
+PYBIND11_MODULE(pyasp, m)
+{
+	m.doc() = "Adaptive superpixels (SLIC, ASP and DASP) for NumPy arrays\n\n"
+		"Input arrays are read in place without copying (inputs which are not C-contiguous or have another\n"
+		"dtype are converted by NumPy first). Output arrays share memory with the result.\n"
+		"All calls use one module-wide thread pool (see set_threads) and release the GIL while computing.";
+
+	m.def("set_threads",
+		[](unsigned threads) { SetThreads(threads); },
+		"Sets the number of threads used by all following calls (0 = one per core, 1 = serial)",
+		py::arg("threads"));
+
+	m.def("get_threads",
+		[]() { return Execution()->concurrency(); },
+		"Number of threads used by the calls");
+
+	m.def("slic",
+		[](InputArray<unsigned char> color, unsigned num_superpixels, float compactness,
+			unsigned iterations, unsigned stride, bool boundary_refinement, bool enforce_connectivity, float time_budget_ms) {
+			const auto size = ImageSize(color, 3, "color");
+			asp::SlicParameters opt;
+			opt.num_superpixels = num_superpixels;
+			opt.compactness = compactness;
+			opt.alic = Alic(iterations, stride, boundary_refinement, enforce_connectivity, time_budget_ms);
+			const asp::ColorView color_view = View<unsigned char,3>(color, size);
+			const auto exec = Execution();
+			asp::Segmentation<asp::PixelRgb> seg;
+			{
+				py::gil_scoped_release release;
+				seg = asp::SuperpixelsSlic(color_view, opt, *exec);
+			}
+			return ToPython(std::move(seg), RGB_COLUMNS);
+		},
+		"SLIC superpixels for a HxWx3 uint8 RGB image",
+		py::arg("color"), py::arg("num_superpixels") = asp::SlicParameters().num_superpixels, py::arg("compactness") = asp::SlicParameters().compactness,
+		py::arg("iterations") = 5, py::arg("stride") = 1, py::arg("boundary_refinement") = false,
+		py::arg("enforce_connectivity") = false, py::arg("time_budget_ms") = 0.0f);
+
+	m.def("asp",
+		[](InputArray<unsigned char> color, InputArray<float> density, float compactness,
+			unsigned iterations, unsigned stride, bool boundary_refinement, bool enforce_connectivity, float time_budget_ms) {
+			const auto size = ImageSize(color, 3, "color");
+			CheckSameSize(ImageSize(density, 1, "density"), size, "density");
+			asp::AspParameters opt;
+			opt.compactness = compactness;
+			opt.alic = Alic(iterations, stride, boundary_refinement, enforce_connectivity, time_budget_ms);
+			const asp::ColorView color_view = View<unsigned char,3>(color, size);
+			const asp::DensityView density_view = View<float,1>(density, size);
+			const auto exec = Execution();
+			asp::Segmentation<asp::PixelRgb> seg;
+			{
+				py::gil_scoped_release release;
+				seg = asp::SuperpixelsAsp(color_view, density_view, opt, *exec);
+			}
+			return ToPython(std::move(seg), RGB_COLUMNS);
+		},
+		"ASP superpixels for a HxWx3 uint8 RGB image and a HxW float32 density (expected superpixels per pixel)",
+		py::arg("color"), py::arg("density"), py::arg("compactness") = asp::AspParameters().compactness,
+		py::arg("iterations") = 5, py::arg("stride") = 1, py::arg("boundary_refinement") = false,
+		py::arg("enforce_connectivity") = false, py::arg("time_budget_ms") = 0.0f);
+
+	m.def("dasp",
+		[](InputArray<unsigned char> color, InputArray<uint16_t> depth, float focal_px, float depth_to_z, float radius,
+			unsigned num_superpixels, float compactness, float normal_weight,
+			unsigned iterations, unsigned stride, bool boundary_refinement, bool enforce_connectivity, float time_budget_ms) {
+			const auto size = ImageSize(color, 3, "color");
+			CheckSameSize(ImageSize(depth, 1, "depth"), size, "depth");
+			asp::DaspParameters opt;
+			opt.focal_px = focal_px;
+			opt.depth_to_z = depth_to_z;
+			opt.radius = radius;
+			opt.num_superpixels = num_superpixels;
+			opt.compactness = compactness;
+			opt.normal_weight = normal_weight;
+			opt.alic = Alic(iterations, stride, boundary_refinement, enforce_connectivity, time_budget_ms);
+			asp::RawFrameView frame;
+			frame.width = size.first;
+			frame.height = size.second;
+			frame.color = color.data();
+			frame.depth = depth.data();
+			const auto exec = Execution();
+			asp::Segmentation<asp::PixelRgbd> seg;
+			{
+				py::gil_scoped_release release;
+				seg = asp::SuperpixelsDasp(frame, opt, *exec);
+			}
+			return ToPython(std::move(seg), RGBD_COLUMNS);
+		},
+		"DASP superpixels for a HxWx3 uint8 RGB image and a HxW uint16 depth image (0 = invalid)",
+		py::arg("color"), py::arg("depth"),
+		py::arg("focal_px") = asp::DaspParameters().focal_px, py::arg("depth_to_z") = asp::DaspParameters().depth_to_z,
+		py::arg("radius") = asp::DaspParameters().radius, py::arg("num_superpixels") = 0,
+		py::arg("compactness") = asp::DaspParameters().compactness, py::arg("normal_weight") = asp::DaspParameters().normal_weight,
+		py::arg("iterations") = 5, py::arg("stride") = 1, py::arg("boundary_refinement") = false,
+		py::arg("enforce_connectivity") = false, py::arg("time_budget_ms") = 0.0f);
+}
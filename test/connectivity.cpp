@@ -0,0 +1,100 @@
+/** Connectivity enforcement (AlicParameters::enforce_connectivity) */
+
+#include "testing.hpp"
+#include <asp/algos.hpp>
+#include <cmath>
+#include <vector>
+
+using namespace asp;
+using namespace asp::test;
+
+/** Number of superpixels whose pixels form more than one 4-connected component */
+int NumFragmented(const slimage::Image<int,1>& indices, size_t num_superpixels)
+{
+	const int width = indices.width();
+	const int height = indices.height();
+	std::vector<int> components(num_superpixels, 0);
+	slimage::Image<int,1> visited{static_cast<unsigned>(width), static_cast<unsigned>(height), 0};
+	std::vector<std::pair<int,int>> stack;
+	for(int y=0; y<height; y++) {
+		for(int x=0; x<width; x++) {
+			const int label = indices(x,y);
+			if(label < 0 || visited(x,y)) {
+				continue;
+			}
+			components[label]++;
+			visited(x,y) = 1;
+			stack.push_back({x,y});
+			while(!stack.empty()) {
+				const int u = stack.back().first;
+				const int v = stack.back().second;
+				stack.pop_back();
+				const int nb[4][2] = {{u-1,v}, {u+1,v}, {u,v-1}, {u,v+1}};
+				for(const auto& p : nb) {
+					if(0 <= p[0] && p[0] < width && 0 <= p[1] && p[1] < height
+						&& !visited(p[0],p[1]) && indices(p[0],p[1]) == label) {
+						visited(p[0],p[1]) = 1;
+						stack.push_back({p[0],p[1]});
+					}
+				}
+			}
+		}
+	}
+	int num = 0;
+	for(int c : components) {
+		num += (c > 1) ? 1 : 0;
+	}
+	return num;
+}
+
+/** True if superpixel positions are the mean positions of their pixels after relabeling */
+template<typename T>
+bool MeansMatchLabels(const Segmentation<T>& s)
+{
+	std::vector<double> num(s.superpixels.size(), 0.0);
+	std::vector<Eigen::Vector2d> position(s.superpixels.size(), Eigen::Vector2d::Zero());
+	for(size_t i=0; i<s.indices.size(); i++) {
+		const int label = s.indices[i];
+		if(label >= 0) {
+			num[label] += s.input[i].num;
+			position[label] += static_cast<double>(s.input[i].num) * s.input[i].position.template cast<double>();
+		}
+	}
+	for(size_t i=0; i<s.superpixels.size(); i++) {
+		if(num[i] > 0.0 && (position[i] / num[i] - s.superpixels[i].position.template cast<double>()).norm() > 1e-2) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const unsigned width = 320, height = 240;
+	const slimage::Image3ub color = MakeColor(width, height);
+	const slimage::Image1ui16 depth = MakeDepth(width, height);
+	const slimage::Image1f density = MakeDensity(width, height, 300.0f);
+	const ExecutionContext exec(4);
+
+	for(unsigned stride : {1u, 2u}) {
+		AspParameters asp_opt;
+		asp_opt.alic.enforce_connectivity = true;
+		asp_opt.alic.stride = stride;
+		const Segmentation<PixelRgb> asp = SuperpixelsAsp(color, density, asp_opt, exec);
+		ASP_CHECK(!asp.superpixels.empty());
+		ASP_CHECK(NumFragmented(asp.indices, asp.superpixels.size()) == 0);
+		ASP_CHECK(MeansMatchLabels(asp));
+		ASP_CHECK(SameSegmentation(asp, SuperpixelsAsp(color, density, asp_opt, ExecutionContext::Serial())));
+
+		DaspParameters dasp_opt;
+		dasp_opt.alic.enforce_connectivity = true;
+		dasp_opt.alic.stride = stride;
+		const Segmentation<PixelRgbd> dasp = SuperpixelsDasp(color, depth, dasp_opt, exec);
+		ASP_CHECK(!dasp.superpixels.empty());
+		ASP_CHECK(NumFragmented(dasp.indices, dasp.superpixels.size()) == 0);
+		ASP_CHECK(MeansMatchLabels(dasp));
+		ASP_CHECK(SameSegmentation(dasp, SuperpixelsDasp(color, depth, dasp_opt, ExecutionContext::Serial())));
+	}
+
+	return Result();
+}
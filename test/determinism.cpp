@@ -0,0 +1,42 @@
+/** Results must not depend on the number of threads of the execution context */
+
+#include "testing.hpp"
+#include <asp/algos.hpp>
+#include <asp/pds.hpp>
+
+using namespace asp;
+using namespace asp::test;
+
+int main()
+{
+	const unsigned width = 320, height = 240;
+	const slimage::Image3ub color = MakeColor(width, height);
+	const slimage::Image1ui16 depth = MakeDepth(width, height);
+	const slimage::Image1f density = MakeDensity(width, height, 300.0f);
+	Eigen::MatrixXf density_mat{width, height};
+	for(unsigned y=0; y<height; y++) {
+		for(unsigned x=0; x<width; x++) {
+			density_mat(x,y) = density(x,y);
+		}
+	}
+
+	const ExecutionContext& serial = ExecutionContext::Serial();
+	const Segmentation<PixelRgb> slic = SuperpixelsSlic(color, SlicParameters(), serial);
+	const Segmentation<PixelRgb> asp = SuperpixelsAsp(color, density, AspParameters(), serial);
+	const Segmentation<PixelRgbd> dasp = SuperpixelsDasp(color, depth, DaspParameters(), serial);
+	const std::vector<Eigen::Vector2f> seeds = PdsRandomCounter(density_mat, 17, serial);
+	ASP_CHECK(!slic.superpixels.empty());
+	ASP_CHECK(!asp.superpixels.empty());
+	ASP_CHECK(!dasp.superpixels.empty());
+	ASP_CHECK(!seeds.empty());
+
+	for(unsigned num_threads : {2u, 3u, 8u}) {
+		const ExecutionContext exec(num_threads);
+		ASP_CHECK(SameSegmentation(slic, SuperpixelsSlic(color, SlicParameters(), exec)));
+		ASP_CHECK(SameSegmentation(asp, SuperpixelsAsp(color, density, AspParameters(), exec)));
+		ASP_CHECK(SameSegmentation(dasp, SuperpixelsDasp(color, depth, DaspParameters(), exec)));
+		ASP_CHECK(seeds == PdsRandomCounter(density_mat, 17, exec));
+	}
+
+	return Result();
+}
@@ -0,0 +1,128 @@
+/** Inverse pixel index of segmentations (AlicParameters::membership) */
+
+#include "testing.hpp"
+#include <asp/algos.hpp>
+#include <algorithm>
+#include <vector>
+
+using namespace asp;
+using namespace asp::test;
+
+/** True if the pixel index lists each labeled pixel once under its label in row-major order */
+bool PixelsMatchLabels(const SuperpixelMembership& m, const slimage::Image<int,1>& indices, size_t num_superpixels)
+{
+	if(m.offsets.size() != num_superpixels + 1 || m.offsets.front() != 0 || m.offsets.back() != m.pixels.size()) {
+		return false;
+	}
+	std::vector<int> seen(indices.size(), 0);
+	for(size_t i=0; i<num_superpixels; i++) {
+		for(unsigned k=m.offsets[i]; k<m.offsets[i+1]; k++) {
+			const unsigned p = m.pixels[k];
+			if(p >= indices.size() || indices[p] != static_cast<int>(i) || (k > m.offsets[i] && p <= m.pixels[k-1])) {
+				return false;
+			}
+			seen[p]++;
+		}
+	}
+	for(size_t p=0; p<indices.size(); p++) {
+		if(seen[p] != (indices[p] >= 0 ? 1 : 0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** True if the runs cover each labeled pixel once under its label in row-major order */
+bool RunsMatchLabels(const SuperpixelMembership& m, const slimage::Image<int,1>& indices, size_t num_superpixels)
+{
+	if(m.run_offsets.size() != num_superpixels + 1 || m.run_offsets.front() != 0 || m.run_offsets.back() != m.runs.size()) {
+		return false;
+	}
+	const unsigned width = indices.width();
+	std::vector<int> seen(indices.size(), 0);
+	for(size_t i=0; i<num_superpixels; i++) {
+		for(unsigned k=m.run_offsets[i]; k<m.run_offsets[i+1]; k++) {
+			const PixelRun& r = m.runs[k];
+			if(r.x1 >= r.x2 || r.x2 > width || r.y >= indices.height()) {
+				return false;
+			}
+			if(k > m.run_offsets[i]) {
+				const PixelRun& q = m.runs[k-1];
+				if(r.y < q.y || (r.y == q.y && r.x1 <= q.x2)) {
+					return false;
+				}
+			}
+			for(unsigned x=r.x1; x<r.x2; x++) {
+				if(indices(x, r.y) != static_cast<int>(i)) {
+					return false;
+				}
+				seen[r.y*width + x]++;
+			}
+		}
+	}
+	for(size_t p=0; p<indices.size(); p++) {
+		if(seen[p] != (indices[p] >= 0 ? 1 : 0)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const unsigned width = 320, height = 240;
+	const slimage::Image3ub color = MakeColor(width, height);
+	const slimage::Image1ui16 depth = MakeDepth(width, height);
+	const slimage::Image1f density = MakeDensity(width, height, 300.0f);
+	const ExecutionContext exec(4);
+
+	for(MembershipIndex mode : {MembershipIndex::Pixels, MembershipIndex::Runs}) {
+		auto matches = [mode](const SuperpixelMembership& m, const slimage::Image<int,1>& indices, size_t n) {
+			return (mode == MembershipIndex::Pixels)
+				? PixelsMatchLabels(m, indices, n) && !m.hasRuns()
+				: RunsMatchLabels(m, indices, n) && !m.hasPixels();
+		};
+
+		SlicParameters slic_opt;
+		slic_opt.alic.membership = mode;
+		const Segmentation<PixelRgb> slic = SuperpixelsSlic(color, slic_opt, exec);
+		ASP_CHECK(matches(slic.membership, slic.indices, slic.superpixels.size()));
+
+		// with skipped pixels and connectivity enforcement the index uses the final labels
+		AspParameters asp_opt;
+		asp_opt.alic.membership = mode;
+		asp_opt.alic.stride = 2;
+		asp_opt.alic.enforce_connectivity = true;
+		const Segmentation<PixelRgb> asp = SuperpixelsAsp(color, density, asp_opt, exec);
+		ASP_CHECK(matches(asp.membership, asp.indices, asp.superpixels.size()));
+
+		// invalid depth pixels have no label and are not in the index
+		DaspParameters dasp_opt;
+		dasp_opt.alic.membership = mode;
+		const Segmentation<PixelRgbd> dasp = SuperpixelsDasp(color, depth, dasp_opt, exec);
+		ASP_CHECK(matches(dasp.membership, dasp.indices, dasp.superpixels.size()));
+		ASP_CHECK(std::count(dasp.indices.begin(), dasp.indices.end(), -1) > 0);
+
+		// the index is the same as computed afterwards and does not depend on the thread count
+		const SuperpixelMembership serial = ComputeMembership(dasp.indices, dasp.superpixels.size(), mode);
+		ASP_CHECK(serial.offsets == dasp.membership.offsets && serial.pixels == dasp.membership.pixels);
+		ASP_CHECK(serial.run_offsets == dasp.membership.run_offsets);
+
+		// an incremental update rebuilds the index
+		slimage::Image3ub color2{width, height};
+		std::copy(color.begin(), color.end(), color2.begin());
+		for(unsigned y=60; y<90; y++) {
+			for(unsigned x=40; x<100; x++) {
+				color2(x,y) = slimage::Pixel3ub{255, 255, 255};
+			}
+		}
+		AspParameters update_opt;
+		update_opt.alic.membership = mode;
+		const Segmentation<PixelRgb> before = SuperpixelsAsp(color, density, update_opt, exec);
+		const slimage::Image1ub changed = AspChangeMask(before, color2, density, 0.1f, 0.1f, exec);
+		const Segmentation<PixelRgb> updated = SuperpixelsAspUpdate(before, color2, density, changed, update_opt, exec);
+		ASP_CHECK(matches(updated.membership, updated.indices, updated.superpixels.size()));
+	}
+
+	return Result();
+}
@@ -0,0 +1,41 @@
+/** SuperpixelsDasp with pixel features pruned to the ones needed by the distance function */
+
+#include "testing.hpp"
+#include <asp/algos.hpp>
+#include <cmath>
+
+using namespace asp;
+using namespace asp::test;
+
+int main()
+{
+	const unsigned width = 320, height = 240;
+	const slimage::Image3ub color = MakeColor(width, height);
+	const slimage::Image1ui16 depth = MakeDepth(width, height);
+	const ExecutionContext exec(4);
+
+	// normal_weight=0 only needs 3D points and color
+	DaspParameters opt;
+	opt.normal_weight = 0.0f;
+	ASP_CHECK(DaspRequiredFeatures(opt) == (RgbdWorld | RgbdColor));
+	DaspParameters opt_full = opt;
+	opt_full.full_feature_means = true;
+	const Segmentation<PixelRgbd> pruned = SuperpixelsDasp(color, depth, opt, exec);
+	const Segmentation<PixelRgbd> full = SuperpixelsDasp(color, depth, opt_full, exec);
+	ASP_CHECK(!full.superpixels.empty());
+	ASP_CHECK(SameSegmentation(pruned, full));
+	ASP_CHECK(pruned.density_scale == full.density_scale);
+	ASP_CHECK(pruned.iterations == full.iterations);
+	// computed features have the same means, depth is the z coordinate and normals are not computed
+	bool same_features = true;
+	for(size_t i=0; i<full.superpixels.size(); i++) {
+		const auto& a = pruned.superpixels[i].data;
+		const auto& b = full.superpixels[i].data;
+		same_features = same_features && a.color == b.color && a.world == b.world
+			&& std::abs(a.depth - b.depth) <= 1e-5f * b.depth
+			&& a.normal == Eigen::Vector3f(0.0f, 0.0f, -1.0f);
+	}
+	ASP_CHECK(same_features);
+
+	return Result();
+}
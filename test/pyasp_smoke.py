@@ -0,0 +1,55 @@
+"""Smoke test of the Python bindings (run by 'make test' if configured with -DASP_PYTHON=ON)"""
+
+import sys
+import numpy as np
+import pyasp
+
+
+def check(cond, what):
+    if not cond:
+        print("check failed: " + what, file=sys.stderr)
+        sys.exit(1)
+
+
+def main():
+    height, width = 120, 160
+    y, x = np.mgrid[0:height, 0:width]
+    color = np.stack([((x // 37 + y // 23) % 3) * 100, x % 256, (x * y) % 256], axis=2).astype(np.uint8)
+    depth = (1000 + 3 * x).astype(np.uint16)
+    density = np.full((height, width), 100.0 / (width * height), dtype=np.float32)
+
+    pyasp.set_threads(2)
+    check(pyasp.get_threads() == 2, "set_threads")
+
+    for name, r in [
+            ("slic", pyasp.slic(color, num_superpixels=100)),
+            ("asp", pyasp.asp(color, density)),
+            ("dasp", pyasp.dasp(color, depth))]:
+        indices = r["indices"]
+        superpixels = r["superpixels"]
+        check(indices.shape == (height, width), name + " indices shape")
+        check(r["weights"].shape == (height, width), name + " weights shape")
+        check(superpixels.shape[1] == len(r["columns"]), name + " superpixel columns")
+        check(superpixels.shape[0] > 0, name + " has superpixels")
+        check(indices.max() < superpixels.shape[0], name + " labels")
+
+    # non-contiguous inputs are converted by NumPy
+    r = pyasp.slic(np.asfortranarray(color), num_superpixels=100)
+    check(np.array_equal(r["indices"], pyasp.slic(color, num_superpixels=100)["indices"]), "non-contiguous input")
+
+    # empty arrays and wrong shapes are rejected
+    for bad in [np.zeros((0, 0, 3), dtype=np.uint8), np.zeros((height, width), dtype=np.uint8)]:
+        try:
+            pyasp.slic(bad)
+            check(False, "invalid input shape " + str(bad.shape) + " accepted")
+        except ValueError:
+            pass
+    try:
+        pyasp.dasp(color, depth[:10])
+        check(False, "depth of another size accepted")
+    except ValueError:
+        pass
+
+
+if __name__ == "__main__":
+    main()
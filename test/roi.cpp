@@ -0,0 +1,117 @@
+/** Superpixels restricted to a mask or to regions of interest */
+
+#include "testing.hpp"
+#include <asp/algos.hpp>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+using namespace asp;
+using namespace asp::test;
+
+bool Contains(const Roi& box, float x, float y)
+{
+	return box.x <= x && x < box.x + box.width && box.y <= y && y < box.y + box.height;
+}
+
+/** Checks labels against the mask and that no superpixel crosses from one region into another */
+template<typename T>
+void CheckRegions(const Segmentation<T>& s, const slimage::Image1ub& mask, const std::vector<Roi>& boxes)
+{
+	ASP_CHECK(s.input.size() == 0);
+	ASP_CHECK(s.indices.width() == mask.width() && s.indices.height() == mask.height());
+	ASP_CHECK(!s.superpixels.empty());
+	std::vector<std::set<int>> labels(boxes.size());
+	bool outside_unlabeled = true;
+	bool inside_labeled = true;
+	for(unsigned y=0; y<mask.height(); y++) {
+		for(unsigned x=0; x<mask.width(); x++) {
+			const int label = s.indices(x,y);
+			if(!mask(x,y)) {
+				outside_unlabeled = outside_unlabeled && label == -1;
+				continue;
+			}
+			inside_labeled = inside_labeled && 0 <= label && label < static_cast<int>(s.superpixels.size());
+			for(size_t k=0; k<boxes.size(); k++) {
+				if(Contains(boxes[k], x, y)) {
+					labels[k].insert(label);
+				}
+			}
+		}
+	}
+	ASP_CHECK(outside_unlabeled);
+	ASP_CHECK(inside_labeled);
+	for(size_t k=0; k<boxes.size(); k++) {
+		for(size_t j=k+1; j<boxes.size(); j++) {
+			for(int label : labels[k]) {
+				ASP_CHECK(labels[j].count(label) == 0);
+			}
+		}
+	}
+	// superpixels are in image coordinates
+	bool in_box = true;
+	for(size_t k=0; k<boxes.size(); k++) {
+		for(int label : labels[k]) {
+			const auto& p = s.superpixels[label].position;
+			in_box = in_box && Contains(boxes[k], p.x(), p.y());
+		}
+	}
+	ASP_CHECK(in_box);
+}
+
+int main()
+{
+	const unsigned width = 320, height = 240;
+	const slimage::Image3ub color = MakeColor(width, height);
+	const slimage::Image1ui16 depth = MakeDepth(width, height);
+	const slimage::Image1f density = MakeDensity(width, height, 300.0f);
+	const ExecutionContext exec(4);
+
+	// regions: boxes are merged if they overlap and clipped to the image
+	const std::vector<Roi> rois = { Roi{200, 150, 200, 200}, Roi{10, 20, 60, 50}, Roi{40, 40, 50, 40} };
+	const std::vector<Roi> boxes = MergeRois(width, height, rois);
+	ASP_CHECK(boxes.size() == 2);
+	ASP_CHECK(boxes[0].x == 10 && boxes[0].y == 20 && boxes[0].width == 80 && boxes[0].height == 60);
+	ASP_CHECK(boxes[1].x == 200 && boxes[1].y == 150 && boxes[1].width == 120 && boxes[1].height == 90);
+	const slimage::Image1ub mask = RoiMask(width, height, rois);
+	const std::vector<Roi> regions = MaskRegions(mask, exec);
+	ASP_CHECK(regions.size() == 2);
+	for(size_t k=0; k<regions.size() && k<boxes.size(); k++) {
+		ASP_CHECK(regions[k].x == boxes[k].x && regions[k].y == boxes[k].y
+			&& regions[k].width == boxes[k].width && regions[k].height == boxes[k].height);
+	}
+	slimage::Image1ub empty_mask{width, height};
+	std::fill(empty_mask.begin(), empty_mask.end(), 0);
+	ASP_CHECK(MaskRegions(empty_mask, exec).empty());
+
+	const Segmentation<PixelRgb> slic = SuperpixelsSlic(color, mask, SlicParameters(), exec);
+	CheckRegions(slic, mask, boxes);
+	ASP_CHECK(SameSegmentation(slic, SuperpixelsSlic(color, rois, SlicParameters(), exec)));
+	ASP_CHECK(SameSegmentation(slic, SuperpixelsSlic(color, mask, SlicParameters(), ExecutionContext::Serial())));
+
+	AspParameters asp_opt;
+	asp_opt.alic.membership = MembershipIndex::Pixels;
+	const Segmentation<PixelRgb> asp = SuperpixelsAsp(color, density, mask, asp_opt, exec);
+	CheckRegions(asp, mask, boxes);
+	ASP_CHECK(SameSegmentation(asp, SuperpixelsAsp(color, density, rois, asp_opt, exec)));
+	// membership index in image coordinates
+	bool membership_ok = asp.membership.offsets.size() == asp.superpixels.size() + 1;
+	for(size_t i=0; membership_ok && i<asp.superpixels.size(); i++) {
+		for(unsigned k=asp.membership.offsets[i]; k<asp.membership.offsets[i+1]; k++) {
+			membership_ok = membership_ok && asp.indices[asp.membership.pixels[k]] == static_cast<int>(i);
+		}
+	}
+	ASP_CHECK(membership_ok);
+	ASP_CHECK(asp.membership.pixels.size() == static_cast<size_t>(std::count(mask.begin(), mask.end(), 1)));
+
+	const Segmentation<PixelRgbd> dasp = SuperpixelsDasp(color, depth, mask, DaspParameters(), exec);
+	CheckRegions(dasp, mask, boxes);
+	ASP_CHECK(SameSegmentation(dasp, SuperpixelsDasp(color, depth, rois, DaspParameters(), exec)));
+
+	// an empty mask gives no superpixels
+	const Segmentation<PixelRgb> none = SuperpixelsAsp(color, density, empty_mask, AspParameters(), exec);
+	ASP_CHECK(none.superpixels.empty());
+	ASP_CHECK(std::count(none.indices.begin(), none.indices.end(), -1) == static_cast<long>(none.indices.size()));
+
+	return Result();
+}
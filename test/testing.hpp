@@ -0,0 +1,102 @@
+#pragma once
+
+#include <asp/segmentation.hpp>
+#include <slimage/image.hpp>
+#include <iostream>
+#include <cstdint>
+
+/** Checks a condition and reports the failure with file and line */
+#define ASP_CHECK(cond) asp::test::Check((cond), #cond, __FILE__, __LINE__)
+
+namespace asp {
+namespace test
+{
+	/** Number of failed checks so far */
+	inline int& Failures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline void Check(bool ok, const char* what, const char* file, int line)
+	{
+		if(!ok) {
+			std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+			Failures()++;
+		}
+	}
+
+	/** Exit code for main */
+	inline int Result()
+	{
+		if(Failures() > 0) {
+			std::cerr << Failures() << " check(s) failed" << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
+	/** Synthetic color image with blocks of three colors and two gradients */
+	inline slimage::Image3ub MakeColor(unsigned width, unsigned height)
+	{
+		slimage::Image3ub color{width, height};
+		for(unsigned y=0; y<height; y++) {
+			for(unsigned x=0; x<width; x++) {
+				const unsigned char v = ((x/37 + y/23) % 3) * 100;
+				color(x,y) = slimage::Pixel3ub{v, static_cast<unsigned char>(x % 256), static_cast<unsigned char>((x*y) % 256)};
+			}
+		}
+		return color;
+	}
+
+	/** Synthetic depth image with a slope, a step and a block of invalid pixels (depth 0) in the upper right */
+	inline slimage::Image1ui16 MakeDepth(unsigned width, unsigned height)
+	{
+		slimage::Image1ui16 depth{width, height};
+		for(unsigned y=0; y<height; y++) {
+			for(unsigned x=0; x<width; x++) {
+				const bool hole = (x > (width*25)/32 && y < (height*5)/24);
+				depth(x,y) = hole ? 0 : static_cast<uint16_t>(1000 + 3*x + (x > width/2 ? 500 : 0));
+			}
+		}
+		return depth;
+	}
+
+	/** Density for about 'num' superpixels which is three times higher in the left half */
+	inline slimage::Image1f MakeDensity(unsigned width, unsigned height, float num)
+	{
+		const float base = num / (2.0f * static_cast<float>(width*height));
+		slimage::Image1f density{width, height};
+		for(unsigned y=0; y<height; y++) {
+			for(unsigned x=0; x<width; x++) {
+				density(x,y) = (x < width/2) ? 3.0f*base : base;
+			}
+		}
+		return density;
+	}
+
+	/** True if both segmentations have identical labels and superpixel positions */
+	template<typename T>
+	bool SameSegmentation(const Segmentation<T>& a, const Segmentation<T>& b)
+	{
+		if(a.superpixels.size() != b.superpixels.size()
+			|| a.indices.width() != b.indices.width()
+			|| a.indices.height() != b.indices.height()) {
+			return false;
+		}
+		for(size_t i=0; i<a.indices.size(); i++) {
+			if(a.indices[i] != b.indices[i]) {
+				return false;
+			}
+		}
+		for(size_t i=0; i<a.superpixels.size(); i++) {
+			if(a.superpixels[i].position != b.superpixels[i].position
+				|| a.superpixels[i].density != b.superpixels[i].density) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+}
+}
@@ -0,0 +1,73 @@
+/** Incremental updates with a change mask (SuperpixelsAspUpdate, SuperpixelsDaspUpdate) */
+
+#include "testing.hpp"
+#include <asp/algos.hpp>
+#include <algorithm>
+#include <vector>
+
+using namespace asp;
+using namespace asp::test;
+
+int main()
+{
+	const unsigned width = 320, height = 240;
+	const slimage::Image3ub color = MakeColor(width, height);
+	const slimage::Image1ui16 depth = MakeDepth(width, height);
+	const slimage::Image1f density = MakeDensity(width, height, 300.0f);
+	const ExecutionContext exec(4);
+
+	// an unchanged frame gives an empty change mask and keeps the segmentation
+	const Segmentation<PixelRgb> asp = SuperpixelsAsp(color, density, AspParameters(), exec);
+	const slimage::Image1ub none = AspChangeMask(asp, color, density, 0.1f, 0.1f, exec);
+	ASP_CHECK(std::count(none.begin(), none.end(), 0) == static_cast<long>(none.size()));
+	const Segmentation<PixelRgb> asp_same = SuperpixelsAspUpdate(asp, color, density, none, AspParameters(), exec);
+	ASP_CHECK(SameSegmentation(asp, asp_same));
+	ASP_CHECK(asp_same.iterations == 0);
+
+	const Segmentation<PixelRgbd> dasp = SuperpixelsDasp(color, depth, DaspParameters(), exec);
+	const slimage::Image1ub dasp_none = DaspChangeMask(dasp, color, depth, DaspParameters(), 0.1f, 0.02f, exec);
+	ASP_CHECK(std::count(dasp_none.begin(), dasp_none.end(), 0) == static_cast<long>(dasp_none.size()));
+	ASP_CHECK(SameSegmentation(dasp, SuperpixelsDaspUpdate(dasp, color, depth, dasp_none, DaspParameters(), exec)));
+
+	// a changed block only changes labels within twice the search radius (3*13 pixels) of the block
+	slimage::Image3ub color2{width, height};
+	std::copy(color.begin(), color.end(), color2.begin());
+	for(unsigned y=100; y<130; y++) {
+		for(unsigned x=150; x<190; x++) {
+			color2(x,y) = slimage::Pixel3ub{255, 255, 255};
+		}
+	}
+	const slimage::Image1ub changed = AspChangeMask(asp, color2, density, 0.1f, 0.1f, exec);
+	const Roi box = MaskBoundingBox(changed);
+	ASP_CHECK(!box.empty() && box.x >= 150 && box.x + box.width <= 190 && box.y >= 100 && box.y + box.height <= 130);
+	const std::vector<int> labels_before(asp.indices.begin(), asp.indices.end());
+	const Segmentation<PixelRgb> updated = SuperpixelsAspUpdate(asp, color2, density, changed, AspParameters(), exec);
+	// the copying version leaves the previous segmentation untouched
+	ASP_CHECK(std::equal(labels_before.begin(), labels_before.end(), asp.indices.begin()));
+	ASP_CHECK(updated.superpixels.size() == asp.superpixels.size());
+	ASP_CHECK(updated.iterations > 0);
+	unsigned num_relabeled = 0;
+	bool far_kept = true;
+	for(unsigned y=0; y<height; y++) {
+		for(unsigned x=0; x<width; x++) {
+			if(updated.indices(x,y) != asp.indices(x,y)) {
+				num_relabeled++;
+				far_kept = far_kept && x + 80 >= 150 && x < 190 + 80 && y + 80 >= 100 && y < 130 + 80;
+			}
+		}
+	}
+	ASP_CHECK(num_relabeled > 0);
+	ASP_CHECK(far_kept);
+
+	// the in-place version gives the same result as the copying one
+	Segmentation<PixelRgb> moved = asp;
+	moved.input = slimage::Image<Pixel<PixelRgb>,1>{width, height};
+	std::copy(asp.input.begin(), asp.input.end(), moved.input.begin());
+	moved.indices = slimage::Image<int,1>{width, height};
+	std::copy(asp.indices.begin(), asp.indices.end(), moved.indices.begin());
+	moved.weights = slimage::Image1f{width, height};
+	std::copy(asp.weights.begin(), asp.weights.end(), moved.weights.begin());
+	ASP_CHECK(SameSegmentation(updated, SuperpixelsAspUpdate(std::move(moved), color2, density, changed, AspParameters(), exec)));
+
+	return Result();
+}
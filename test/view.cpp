@@ -0,0 +1,67 @@
+/** Superpixels for pixel data read through views give the same result as for images */
+
+#include "testing.hpp"
+#include <asp/algos.hpp>
+#include <stdexcept>
+#include <vector>
+
+using namespace asp;
+using namespace asp::test;
+
+int main()
+{
+	const unsigned width = 320, height = 240;
+	const slimage::Image3ub color = MakeColor(width, height);
+	const slimage::Image1ui16 depth = MakeDepth(width, height);
+	const slimage::Image1f density = MakeDensity(width, height, 300.0f);
+	const ExecutionContext exec(4);
+
+	// row-major buffers as e.g. of NumPy arrays
+	std::vector<unsigned char> color_data(3*width*height);
+	std::vector<uint16_t> depth_data(width*height);
+	std::vector<float> density_data(width*height);
+	for(unsigned y=0; y<height; y++) {
+		for(unsigned x=0; x<width; x++) {
+			const size_t i = y*width + x;
+			for(unsigned c=0; c<3; c++) {
+				color_data[3*i + c] = color(x,y)[c];
+			}
+			depth_data[i] = depth(x,y);
+			density_data[i] = density(x,y);
+		}
+	}
+	ColorView color_view;
+	color_view.width = width;
+	color_view.height = height;
+	color_view.data = color_data.data();
+	DensityView density_view;
+	density_view.width = width;
+	density_view.height = height;
+	density_view.data = density_data.data();
+	RawFrameView frame;
+	frame.width = width;
+	frame.height = height;
+	frame.color = color_data.data();
+	frame.depth = depth_data.data();
+
+	ASP_CHECK(SameSegmentation(SuperpixelsSlic(color, SlicParameters(), exec), SuperpixelsSlic(color_view, SlicParameters(), exec)));
+	ASP_CHECK(SameSegmentation(SuperpixelsAsp(color, density, AspParameters(), exec), SuperpixelsAsp(color_view, density_view, AspParameters(), exec)));
+	ASP_CHECK(SameSegmentation(SuperpixelsDasp(color, depth, DaspParameters(), exec), SuperpixelsDasp(frame, DaspParameters(), exec)));
+	DaspParameters pruned_opt;
+	pruned_opt.normal_weight = 0.0f;
+	ASP_CHECK(SameSegmentation(SuperpixelsDasp(color, depth, pruned_opt, exec), SuperpixelsDasp(frame, pruned_opt, exec)));
+
+	// views of different size are rejected
+	DensityView small = density_view;
+	small.height = height / 2;
+	bool thrown = false;
+	try {
+		SuperpixelsAsp(color_view, small, AspParameters(), exec);
+	}
+	catch(const std::runtime_error&) {
+		thrown = true;
+	}
+	ASP_CHECK(thrown);
+
+	return Result();
+}